@@ -0,0 +1,134 @@
+// FluidBenchmark.cpp - times flooding with the fluid simulation (make fluid-bench)
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "PerlinNoise.hpp"
+#include "MatrixSupports.hpp"
+#include "WorldChunksBlocks.hpp"
+#include "JobSystem.hpp"
+#include "Fluids.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const int MAX_STEPS = 2000; // A flood that hasn't settled by now never will
+
+struct FloodResult {
+    int steps = 0;
+    int parallelSteps = 0;
+    bool settled = false;
+    double ms = 0.0;
+    std::size_t peakFrontier = 0;
+    uint64_t cellsVisited = 0, cellsChanged = 0;
+    uint64_t stateHash = 0;
+};
+
+// Height of the highest block in a column, or -1
+int SurfaceHeight(const World& world, int x, int z) {
+    for (int y = (world.highestSection + 1) * world.chunkHeight - 1; y >= world.lowestSection * world.chunkHeight; y--) {
+        if (world.IsBlockAtPosition(x, y, z)) return y;
+    }
+    return -1;
+}
+
+// Every block and fluid level, in chunk order - equal hashes mean the two runs ended the same
+uint64_t HashFluidState(const World& world) {
+    uint64_t hash = 0;
+    for (const Chunk& chunk : world.chunks) {
+        hash = MixHash64(hash ^ PackCoords(static_cast<int>(chunk.offset.x), static_cast<int>(chunk.offset.y), static_cast<int>(chunk.offset.z)));
+        for (int i = 0; i < chunk.VoxelCount(); i++) {
+            hash = MixHash64(hash ^ (static_cast<uint64_t>(chunk.blocks.Get(i)) | static_cast<uint64_t>(chunk.FluidAt(i)) << 8));
+        }
+    }
+    return hash;
+}
+
+// Sources sprinkled over a square in the middle of the world a few blocks above the ground, plus a lava source off to one side, then
+// stepped until nothing moves. The flood is the same size whatever the world size, so its cost shouldn't change with it
+FloodResult Flood(int worldSize, int floodSize, JobSystem* workers, bool trace) {
+    World world;
+    world.SetSeed(1234);
+    world.Initialise();
+    world.worldSize = worldSize;
+    world.GeneratePerlinWorld();
+
+    FluidSimulation fluids(world);
+    fluids.Reset();
+
+    int centre = worldSize * world.chunkSize / 2;
+    for (int z = centre - floodSize / 2; z < centre + floodSize / 2; z += 4) {
+        for (int x = centre - floodSize / 2; x < centre + floodSize / 2; x += 4) {
+            world.AddBlockAtPosition(x, SurfaceHeight(world, x, z) + 3, z, BlockType::Water);
+        }
+    }
+    int lavaX = centre + floodSize / 2 + 4;
+    world.AddBlockAtPosition(lavaX, SurfaceHeight(world, lavaX, centre) + 2, centre, BlockType::Lava);
+    fluids.Update(workers); // Picks up the sources without stepping
+
+    FloodResult result;
+    if (trace) printf("%6s %10s %10s %10s\n", "step", "frontier", "changed", "us");
+    while (result.steps < MAX_STEPS && !fluids.Settled()) {
+        uint64_t changedBefore = fluids.cellsChanged;
+        Clock::time_point start = Clock::now();
+        fluids.Step(workers);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        result.ms += ms;
+        result.peakFrontier = std::max(result.peakFrontier, fluids.FrontierSize());
+        result.steps++;
+        if (trace) printf("%6d %10zu %10llu %10.1f\n", result.steps, fluids.FrontierSize(), static_cast<unsigned long long>(fluids.cellsChanged - changedBefore), ms * 1000.0);
+
+        // Nothing here is lighting or ticking the world
+        world.lightEdits.clear();
+        world.blockUpdates.clear();
+    }
+    result.settled = fluids.Settled();
+    result.cellsVisited = fluids.cellsVisited;
+    result.cellsChanged = fluids.cellsChanged;
+    result.parallelSteps = static_cast<int>(fluids.parallelSteps);
+    result.stateHash = HashFluidState(world);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    // --threads <n> steps big fronts on n workers as well, --flood <blocks> sets the width of the flooded square,
+    // --trace prints every step of the first run, --verify checks the threaded result against a single threaded one
+    int threads = 0;
+    int floodSize = 64; // Wide enough that the front passes FLUID_PARALLEL_CELLS, so --threads really shares steps out
+    bool trace = false, verify = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) trace = true;
+        else if (strcmp(argv[i], "--verify") == 0) verify = true;
+        else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) threads = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--flood") == 0) floodSize = atoi(argv[++i]);
+    }
+
+    std::unique_ptr<JobSystem> workers;
+    if (threads > 0) workers.reset(new JobSystem(threads));
+
+    printf("Flooding a %dx%d square%s\n", floodSize, floodSize, workers ? "" : " on one thread");
+    printf("%6s %7s %9s %8s %12s %12s %12s %12s\n", "world", "steps", "parallel", "ms", "peak front", "cells", "changed", "ns/cell");
+    const int worldSizes[] = { 8, 16, 32 };
+    for (int worldSize : worldSizes) {
+        FloodResult result = Flood(worldSize, floodSize, workers.get(), trace && worldSize == worldSizes[0]);
+        printf("%6d %7d %9d %8.2f %12zu %12llu %12llu %12.1f%s\n", worldSize, result.steps, result.parallelSteps, result.ms, result.peakFrontier,
+               static_cast<unsigned long long>(result.cellsVisited), static_cast<unsigned long long>(result.cellsChanged),
+               result.ms * 1e6 / std::max<uint64_t>(result.cellsVisited, 1), result.settled ? "" : "  (still moving)");
+
+        if (verify && workers) {
+            // A flood that never got big enough to share out would only be checked against itself
+            if (result.parallelSteps == 0) {
+                printf("  no step reached %d cells, so nothing ran on the workers - use a bigger --flood\n", FLUID_PARALLEL_CELLS);
+                return 1;
+            }
+            FloodResult single = Flood(worldSize, floodSize, nullptr, false);
+            printf("  %s the single threaded run\n", single.stateHash == result.stateHash ? "matches" : "DIFFERS FROM");
+            if (single.stateHash != result.stateHash) return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+// LightBenchmark.cpp - times incremental light updates (make light-bench)
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "PerlinNoise.hpp"
+#include "MatrixSupports.hpp"
+#include "WorldChunksBlocks.hpp"
+#include "Lighting.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void BuildWorld(World& world, int worldSize) {
+    world.SetSeed(1234);
+    world.Initialise();
+    world.worldSize = worldSize;
+    world.GeneratePerlinWorld();
+}
+
+// Height of the highest block in a column, or -1
+int SurfaceHeight(const World& world, int x, int z) {
+    for (int y = (world.highestSection + 1) * world.chunkHeight - 1; y >= world.lowestSection * world.chunkHeight; y--) {
+        if (world.IsBlockAtPosition(x, y, z)) return y;
+    }
+    return -1;
+}
+
+// Compare incrementally maintained light against a fresh relight of a copy of the world
+int CountMismatches(const World& world) {
+    World fresh = world;
+    RelightAll(fresh);
+    int mismatches = 0;
+    for (size_t i = 0; i < world.chunks.size(); i++) {
+        for (size_t j = 0; j < world.chunks[i].light.size(); j++) {
+            if (world.chunks[i].light[j] != fresh.chunks[i].light[j]) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    bool verify = argc > 1 && std::strcmp(argv[1], "--verify") == 0;
+    const int worldSize = 8;
+
+    World world;
+    BuildWorld(world, worldSize);
+    LightEngine engine(world);
+
+    Clock::time_point start = Clock::now();
+    engine.Rebuild();
+    printf("Full relight: %d chunks in %.2f ms\n", static_cast<int>(world.chunks.size()), SecondsSince(start) * 1000.0);
+
+    // Single edits - dig out or build on random surface blocks, settling the light after each one
+    std::mt19937 rng(7);
+    int extent = worldSize * world.chunkSize;
+    std::uniform_int_distribution<int> coord(1, extent - 2);
+    const int editCount = 2000;
+    uint64_t cellsBefore = engine.cellsUpdated;
+    start = Clock::now();
+    for (int i = 0; i < editCount; i++) {
+        int x = coord(rng), z = coord(rng);
+        int y = SurfaceHeight(world, x, z);
+        if (i % 2 == 0 && y > 0) world.RemoveBlockAtPosition(x, y, z);
+        else world.AddBlockAtPosition(x, y + 1, z, BlockType::OakWood);
+        engine.Update(1e9f);
+    }
+    double seconds = SecondsSince(start);
+    printf("Single edits: %d in %.2f ms - %.0f edits/s, %.0f cells/s\n", editCount, seconds * 1000.0,
+           editCount / seconds, (engine.cellsUpdated - cellsBefore) / seconds);
+    if (verify) printf("  mismatches against a full relight: %d\n", CountMismatches(world));
+
+    // Large carve - hollow out a cave under the middle of the world, then roof it back over
+    int carveMin = extent / 2 - 12, carveMax = extent / 2 + 12;
+    for (int pass = 0; pass < 2; pass++) {
+        bool digging = pass == 0;
+        int edits = 0;
+        for (int y = 0; y < 8; y++) {
+            for (int z = carveMin; z < carveMax; z++) {
+                for (int x = carveMin; x < carveMax; x++) {
+                    if (digging && world.IsBlockAtPosition(x, y, z)) { world.RemoveBlockAtPosition(x, y, z); edits++; }
+                    if (!digging && !world.IsBlockAtPosition(x, y, z)) { world.AddBlockAtPosition(x, y, z, BlockType::Stone); edits++; }
+                }
+            }
+        }
+
+        cellsBefore = engine.cellsUpdated;
+        start = Clock::now();
+        int ticks = 0;
+        while (!engine.Update(2.0f)) ticks++;
+        seconds = SecondsSince(start);
+        printf("%s: %d edits settled in %.2f ms over %d tick(s) of 2 ms - %.0f cells/s\n", digging ? "Carve" : "Fill", edits,
+               seconds * 1000.0, ticks + 1, (engine.cellsUpdated - cellsBefore) / seconds);
+        if (verify) printf("  mismatches against a full relight: %d\n", CountMismatches(world));
+    }
+
+    // Tower - a pillar up through new sections with a roof on top, then the pillar knocked out so the roof's shadow reaches the ground
+    int centre = extent / 2;
+    size_t sectionsBefore = world.chunks.size();
+    cellsBefore = engine.cellsUpdated;
+    start = Clock::now();
+    for (int y = SurfaceHeight(world, centre, centre) + 1; y < 48; y++) world.AddBlockAtPosition(centre, y, centre, BlockType::OakWood);
+    for (int z = centre - 8; z <= centre + 8; z++) {
+        for (int x = centre - 8; x <= centre + 8; x++) world.AddBlockAtPosition(x, 48, z, BlockType::Stone);
+    }
+    for (int y = 47; y > 16; y--) world.RemoveBlockAtPosition(centre, y, centre);
+    while (!engine.Update(1e9f)) {}
+    seconds = SecondsSince(start);
+    printf("Tower: %d new sections settled in %.2f ms - %.0f cells/s\n", static_cast<int>(world.chunks.size() - sectionsBefore),
+           seconds * 1000.0, (engine.cellsUpdated - cellsBefore) / seconds);
+    if (verify) printf("  mismatches against a full relight: %d\n", CountMismatches(world));
+    return 0;
+}
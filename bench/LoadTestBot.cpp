@@ -0,0 +1,288 @@
+// LoadTestBot.cpp - simulated clients walking and editing against a world server (make load-test ARGS="--clients 32")
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "PerlinNoise.hpp"
+#include "MatrixSupports.hpp"
+#include "WorldChunksBlocks.hpp"
+#include "NetSocket.hpp"
+#include "NetProtocol.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const float BOT_TICK_SECONDS = 1.0f / 60.0f;
+const float WALK_SPEED = 4.0f;       // Blocks per second, a little under the player's
+const float EDIT_INTERVAL = 0.5f;    // Average seconds between edits
+const int SECTIONS_ABOVE = 2;        // Extra sections asked for over the top of the world, for anything built up since
+
+// One simulated player with its own copy of the world, kept up to date from the server
+struct Bot {
+    NetConnection connection;
+    World world;
+    std::mt19937 random;
+    bool welcomed = false;
+    int lowestSection = 0, highestSection = 0;
+
+    float x = 0.0f, z = 0.0f, heading = 0.0f;
+    int columnX = 0, columnZ = 0;
+    bool placed = false; // Has picked its first set of columns
+    std::vector<std::pair<int, int>> columns;
+    float editTimer = 0.0f;
+
+    // Round trip of the last edit, from sending it to seeing it come back in a batch
+    bool editPending = false;
+    BlockEdit pendingEdit;
+    Clock::time_point editSent;
+
+    int sectionsWaiting = 0; // Requested but not arrived - no editing until the ground is known
+    uint64_t sections = 0, edits = 0;
+    double roundTripTotalMs = 0.0, roundTripMaxMs = 0.0;
+    int roundTrips = 0;
+};
+
+// Latest server figures, as reported to any of the bots
+struct ServerFigures {
+    int reports = 0;
+    double averageTotalMs = 0.0;
+    float maxMs = 0.0f;
+    uint32_t clients = 0;
+};
+
+// Height of the highest block in the bot's copy of a column, or the bottom of the world
+int SurfaceHeight(const Bot& bot, int x, int z) {
+    for (int y = (bot.world.highestSection + 1) * bot.world.chunkHeight - 1; y >= bot.world.lowestSection * bot.world.chunkHeight; y--) {
+        if (bot.world.IsBlockAtPosition(x, y, z)) return y;
+    }
+    return bot.world.lowestSection * bot.world.chunkHeight - 1;
+}
+
+// Ask for every column within the radius that isn't held yet and let go of the ones left behind
+void UpdateColumns(Bot& bot, int radius, int worldSize) {
+    std::vector<uint8_t> payload;
+    std::vector<std::pair<int, int>> wanted;
+    for (int cz = std::max(0, bot.columnZ - radius); cz <= std::min(worldSize - 1, bot.columnZ + radius); cz++) {
+        for (int cx = std::max(0, bot.columnX - radius); cx <= std::min(worldSize - 1, bot.columnX + radius); cx++) wanted.push_back({ cx, cz });
+    }
+
+    for (const std::pair<int, int>& column : bot.columns) {
+        if (std::find(wanted.begin(), wanted.end(), column) != wanted.end()) continue;
+        payload.clear();
+        NetWriter writer(payload);
+        writer.I32(column.first);
+        writer.I32(column.second);
+        bot.connection.Send(MSG_RELEASE_COLUMN, payload);
+    }
+    for (const std::pair<int, int>& column : wanted) {
+        if (std::find(bot.columns.begin(), bot.columns.end(), column) != bot.columns.end()) continue;
+        for (int cy = bot.lowestSection; cy <= bot.highestSection + SECTIONS_ABOVE; cy++) {
+            payload.clear();
+            NetWriter writer(payload);
+            writer.I32(column.first);
+            writer.I32(cy);
+            writer.I32(column.second);
+            bot.connection.Send(MSG_REQUEST_SECTION, payload);
+            bot.sectionsWaiting++;
+        }
+    }
+    bot.columns.swap(wanted);
+}
+
+void HandleMessages(Bot& bot, ServerFigures& server, int& worldSize) {
+    if (!bot.connection.Receive()) return;
+
+    uint8_t type;
+    const uint8_t* data;
+    uint32_t size;
+    while (bot.connection.NextMessage(type, data, size)) {
+        NetReader reader(data, size);
+        if (type == MSG_WELCOME) {
+            worldSize = reader.I32();
+            bot.lowestSection = reader.I32();
+            bot.highestSection = reader.I32();
+            bot.welcomed = true;
+        } else if (type == MSG_SECTION) {
+            if (ReceiveSection(bot.world, reader)) bot.sections++;
+            bot.sectionsWaiting--;
+        } else if (type == MSG_EDITS) {
+            reader.U32();
+            int count = reader.U16();
+            for (int i = 0; i < count; i++) {
+                BlockEdit edit = reader.Edit();
+                if (!reader.ok) break;
+                ApplyBlockEdit(bot.world, edit);
+                bot.edits++;
+
+                if (bot.editPending && edit.added == bot.pendingEdit.added && edit.x == bot.pendingEdit.x && edit.y == bot.pendingEdit.y && edit.z == bot.pendingEdit.z) {
+                    double ms = std::chrono::duration<double, std::milli>(Clock::now() - bot.editSent).count();
+                    bot.roundTripTotalMs += ms;
+                    bot.roundTripMaxMs = std::max(bot.roundTripMaxMs, ms);
+                    bot.roundTrips++;
+                    bot.editPending = false;
+                }
+            }
+        } else if (type == MSG_STATS) {
+            reader.U32();
+            server.clients = reader.U32();
+            server.averageTotalMs += reader.F32();
+            server.maxMs = std::max(server.maxMs, reader.F32());
+            server.reports++;
+        }
+    }
+    bot.world.lightEdits.clear(); // The bots don't light or tick anything
+    bot.world.blockUpdates.clear();
+    bot.world.fluidUpdates.clear();
+}
+
+// Wander about, turning a little at random and bouncing off the edges of the world
+void Walk(Bot& bot, int worldSize) {
+    std::uniform_real_distribution<float> turn(-0.3f, 0.3f);
+    bot.heading += turn(bot.random);
+    float limit = static_cast<float>(worldSize * bot.world.chunkSize) - 1.0f;
+    bot.x += cosf(bot.heading) * WALK_SPEED * BOT_TICK_SECONDS;
+    bot.z += sinf(bot.heading) * WALK_SPEED * BOT_TICK_SECONDS;
+    if (bot.x < 1.0f || bot.x > limit || bot.z < 1.0f || bot.z > limit) {
+        bot.heading += 3.14159265f;
+        bot.x = std::min(std::max(bot.x, 1.0f), limit);
+        bot.z = std::min(std::max(bot.z, 1.0f), limit);
+    }
+}
+
+// Dig out or build on the top of the column in front
+void Edit(Bot& bot) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    bot.editTimer -= BOT_TICK_SECONDS;
+    if (bot.editTimer > 0.0f) return;
+    bot.editTimer = EDIT_INTERVAL * (0.5f + unit(bot.random));
+
+    int x = static_cast<int>(floorf(bot.x + cosf(bot.heading) * 2.0f));
+    int z = static_cast<int>(floorf(bot.z + sinf(bot.heading) * 2.0f));
+    int top = SurfaceHeight(bot, x, z);
+
+    BlockEdit edit;
+    bool dig = unit(bot.random) < 0.5f && top >= bot.world.lowestSection * bot.world.chunkHeight;
+    edit.added = dig ? 0 : 1;
+    edit.x = x;
+    edit.y = dig ? top : top + 1;
+    edit.z = z;
+    edit.type = static_cast<uint8_t>(dig ? BlockType::Air : BlockType::OakWood);
+
+    std::vector<uint8_t> payload;
+    NetWriter writer(payload);
+    writer.Edit(edit);
+    bot.connection.Send(MSG_EDIT, payload);
+    // Only the latest is timed - an edit the server refuses (someone else got there first) never comes back
+    bot.editPending = true;
+    bot.pendingEdit = edit;
+    bot.editSent = Clock::now();
+}
+
+int Usage(const char* program) {
+    printf("Usage: %s [--host address] [--port n] [--clients n] [--seconds n] [--radius columns]\n", program);
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    // --host <address>, --port <n>, --clients <n>, --seconds <n>, --radius <columns>
+    const char* host = "127.0.0.1";
+    uint16_t port = NET_DEFAULT_PORT;
+    int clientCount = 8;
+    double seconds = 10.0;
+    int radius = 2;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return Usage(argv[0]); // Every option takes a value
+        if (strcmp(argv[i], "--host") == 0) host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0) port = static_cast<uint16_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--clients") == 0) clientCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--radius") == 0) radius = atoi(argv[++i]);
+        else return Usage(argv[0]);
+    }
+
+    std::vector<std::unique_ptr<Bot>> bots;
+    std::vector<uint8_t> hello;
+    NetWriter(hello).U32(NET_PROTOCOL_VERSION);
+    for (int i = 0; i < clientCount; i++) {
+        std::unique_ptr<Bot> bot(new Bot());
+        if (!bot->connection.Connect(host, port)) {
+            printf("Failed to connect bot %d to %s:%u\n", i, host, port);
+            return 1;
+        }
+        bot->random.seed(1000 + i);
+        bot->world.Initialise();
+        bot->connection.Send(MSG_HELLO, hello);
+        bots.push_back(std::move(bot));
+    }
+    printf("%d bots connected to %s:%u, running for %.0f s\n", clientCount, host, port, seconds);
+
+    ServerFigures server;
+    int worldSize = 0;
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(BOT_TICK_SECONDS));
+    Clock::time_point start = Clock::now();
+    Clock::time_point nextTick = start;
+    int lost = 0;
+
+    while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+        for (std::unique_ptr<Bot>& bot : bots) {
+            if (!bot->connection.IsOpen()) continue;
+            HandleMessages(*bot, server, worldSize);
+
+            if (bot->welcomed) {
+                if (!bot->placed) {
+                    std::uniform_real_distribution<float> spot(1.0f, worldSize * bot->world.chunkSize - 1.0f);
+                    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+                    bot->x = spot(bot->random);
+                    bot->z = spot(bot->random);
+                    bot->heading = angle(bot->random);
+                }
+                Walk(*bot, worldSize);
+
+                int columnX = FloorDiv(static_cast<int>(bot->x), bot->world.chunkSize);
+                int columnZ = FloorDiv(static_cast<int>(bot->z), bot->world.chunkSize);
+                if (!bot->placed || columnX != bot->columnX || columnZ != bot->columnZ) {
+                    bot->columnX = columnX;
+                    bot->columnZ = columnZ;
+                    bot->placed = true;
+                    UpdateColumns(*bot, radius, worldSize);
+                }
+                if (bot->sectionsWaiting == 0) Edit(*bot);
+            }
+
+            if (!bot->connection.Flush()) lost++;
+        }
+
+        nextTick += tick;
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > tick * 5) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t received = 0, sent = 0, sections = 0, edits = 0;
+    double roundTripTotalMs = 0.0, roundTripMaxMs = 0.0;
+    int roundTrips = 0;
+    for (const std::unique_ptr<Bot>& bot : bots) {
+        received += bot->connection.bytesReceived;
+        sent += bot->connection.bytesSent;
+        sections += bot->sections;
+        edits += bot->edits;
+        roundTripTotalMs += bot->roundTripTotalMs;
+        roundTripMaxMs = std::max(roundTripMaxMs, bot->roundTripMaxMs);
+        roundTrips += bot->roundTrips;
+    }
+
+    double perClient = 1.0 / (clientCount * elapsed * 1024.0);
+    printf("Per client: %.2f KB/s down, %.2f KB/s up (%.1f KB down in total, %llu sections, %llu edits received)\n",
+           received * perClient, sent * perClient, received / 1024.0, static_cast<unsigned long long>(sections), static_cast<unsigned long long>(edits));
+    if (roundTrips > 0) printf("Edit round trip: %.2f ms average, %.2f ms max over %d edits\n", roundTripTotalMs / roundTrips, roundTripMaxMs, roundTrips);
+    if (server.reports > 0) printf("Server tick: %.3f ms average, %.3f ms max with %u clients\n", server.averageTotalMs / server.reports, server.maxMs, server.clients);
+    if (lost > 0) printf("%d bots lost their connection\n", lost);
+    return lost > 0 ? 1 : 0;
+}
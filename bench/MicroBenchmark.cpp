@@ -0,0 +1,282 @@
+// MicroBenchmark.cpp - per-kernel timings for the maths, noise, raycast, block lookup and depth sort code (make micro-bench)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PerlinNoise.hpp"
+#include "MatrixSupports.hpp"
+#include "WorldChunksBlocks.hpp"
+#include "Clipping.hpp"
+#include "Raycast.hpp"
+#include "DepthSort.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const int INPUT_COUNT = 4096;       // Inputs per kernel, cycled through so the branch predictor can't learn a single case
+const double SAMPLE_SECONDS = 0.05; // Each sample runs at least this long
+const int DEFAULT_SAMPLES = 9;
+const double REGRESSION_PERCENT = 5.0; // Comparison flags changes bigger than this
+const int SORT_GRID = 8;               // Depth sort input - a square of chunks in view, each chunk's faces a run for the merge
+const int SORT_FACES_PER_CHUNK = 256;
+
+// Results are folded in here so the compiler can't drop the work
+volatile uint64_t sink = 0;
+
+void Consume(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    sink = sink + bits;
+}
+
+struct Result {
+    std::string name;
+    double nsPerOp;  // Median over the samples
+    double minNs, maxNs;
+};
+
+// Time one kernel - op does one operation on input i. The operation count per sample is doubled until a sample takes SAMPLE_SECONDS,
+// then that many are timed repeatedly. op is a template parameter so it inlines into the loop, like the kernel would at its call sites
+template <typename Op>
+Result Measure(const char* name, Op op, int samples) {
+    long ops = 64;
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        for (long i = 0; i < ops; i++) op(static_cast<int>(i % INPUT_COUNT));
+        if (std::chrono::duration<double>(Clock::now() - start).count() >= SAMPLE_SECONDS) break;
+        ops *= 2;
+    }
+
+    std::vector<double> times;
+    for (int s = 0; s < samples; s++) {
+        Clock::time_point start = Clock::now();
+        for (long i = 0; i < ops; i++) op(static_cast<int>(i % INPUT_COUNT));
+        times.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops);
+    }
+    std::sort(times.begin(), times.end());
+    return { name, times[times.size() / 2], times.front(), times.back() };
+}
+
+// Saved runs are one "name ns_per_op" line per kernel
+bool Save(const char* path, const std::vector<Result>& results) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+    for (const Result& result : results) fprintf(file, "%s %.4f\n", result.name.c_str(), result.nsPerOp);
+    fclose(file);
+    return true;
+}
+
+bool Load(const char* path, std::vector<Result>& results) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+    char name[128];
+    double ns;
+    while (fscanf(file, "%127s %lf", name, &ns) == 2) results.push_back({ name, ns, ns, ns });
+    fclose(file);
+    return true;
+}
+
+// Side by side timings of two saved runs. Returns the number of kernels that got slower by more than REGRESSION_PERCENT
+int Compare(const char* basePath, const char* newPath) {
+    std::vector<Result> base, current;
+    if (!Load(basePath, base) || !Load(newPath, current)) {
+        printf("Failed to read %s or %s\n", basePath, newPath);
+        return -1;
+    }
+
+    int regressions = 0;
+    printf("%-32s %12s %12s %9s\n", "kernel", "base ns/op", "new ns/op", "change");
+    for (const Result& now : current) {
+        auto match = std::find_if(base.begin(), base.end(), [&](const Result& r) { return r.name == now.name; });
+        if (match == base.end()) {
+            printf("%-32s %12s %12.2f %9s\n", now.name.c_str(), "-", now.nsPerOp, "new");
+            continue;
+        }
+        double change = (now.nsPerOp - match->nsPerOp) / match->nsPerOp * 100.0;
+        const char* flag = change > REGRESSION_PERCENT ? "  slower" : change < -REGRESSION_PERCENT ? "  faster" : "";
+        if (change > REGRESSION_PERCENT) regressions++;
+        printf("%-32s %12.2f %12.2f %+8.1f%%%s\n", now.name.c_str(), match->nsPerOp, now.nsPerOp, change, flag);
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    // --out <file> saves the run, --compare <base> <new> diffs two saved runs, --filter <text> runs only kernels whose name contains it
+    const char* outPath = nullptr;
+    const char* filter = nullptr;
+    int samples = DEFAULT_SAMPLES;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc) {
+            int regressions = Compare(argv[i + 1], argv[i + 2]);
+            return regressions == 0 ? 0 : 1;
+        }
+        if (i + 1 >= argc) break;
+        if (strcmp(argv[i], "--out") == 0) outPath = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0) filter = argv[++i];
+        else if (strcmp(argv[i], "--samples") == 0) samples = std::max(1, atoi(argv[++i]));
+    }
+
+    // Fixed seeds throughout, so every run sees the same inputs
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // The game's projection matrix
+    float fNear = 0.1f, fFar = 1000.0f;
+    float fAspectRatio = 720.0f / 1280.0f;
+    float fFovRad = 1.0f / tanf(80.0f * 0.5f / 180.0f * 3.1415926535f);
+    Mat4 matProj;
+    matProj.m[0][0] = fAspectRatio * fFovRad;
+    matProj.m[1][1] = fFovRad;
+    matProj.m[2][2] = fFar / (fFar - fNear);
+    matProj.m[3][2] = (-fFar * fNear) / (fFar - fNear);
+    matProj.m[2][3] = 1.0f;
+
+    // View-space points spread over the visible depth range
+    std::vector<Vec3> points(INPUT_COUNT);
+    for (Vec3& p : points) p = { unit(rng) * 40.0f, unit(rng) * 20.0f, 1.0f + (unit(rng) + 1.0f) * 40.0f };
+
+    std::vector<Mat4> matrices(INPUT_COUNT);
+    std::vector<Vec3> eyes(INPUT_COUNT), targets(INPUT_COUNT);
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        eyes[i] = { unit(rng) * 64.0f, 10.0f + unit(rng) * 10.0f, unit(rng) * 64.0f };
+        targets[i] = eyes[i] + Vec3(unit(rng), unit(rng) * 0.5f, unit(rng));
+        matrices[i] = MatrixPointAt(eyes[i], targets[i], { 0.0f, 1.0f, 0.0f });
+    }
+
+    // Terrain sample points at the frequency world generation uses
+    PerlinNoise perlin(1234);
+    std::vector<Vec3> noisePoints(INPUT_COUNT);
+    for (Vec3& p : noisePoints) p = { (unit(rng) + 1.0f) * 64.0f * 0.15f, (unit(rng) + 1.0f) * 64.0f * 0.15f, 0.0f };
+
+    // An 8x8 column world, with rays from head height pointed the way the player looks - mostly ahead and a little down
+    World world;
+    world.SetSeed(1234);
+    world.Initialise();
+    world.worldSize = 8;
+    world.GeneratePerlinWorld();
+    int extent = world.worldSize * world.chunkSize;
+    std::uniform_int_distribution<int> coord(0, extent - 1);
+    std::uniform_int_distribution<int> height(world.lowestSection * world.chunkHeight, (world.highestSection + 1) * world.chunkHeight - 1);
+    std::vector<Vec3> rayOrigins(INPUT_COUNT), rayDirections(INPUT_COUNT);
+    for (int i = 0; i < INPUT_COUNT; i++) {
+        int x = coord(rng), z = coord(rng);
+        int y = (world.highestSection + 1) * world.chunkHeight;
+        while (y > 0 && !world.IsSolidBlockAt(x, y - 1, z)) y--;
+        rayOrigins[i] = { x + 0.5f, y + 1.6f, z + 0.5f };
+        rayDirections[i] = Vec3(unit(rng), -0.2f - 0.5f * (unit(rng) + 1.0f), unit(rng)).normalize();
+    }
+
+    // Block lookups spread over everywhere blocks can be, hits and misses both
+    std::vector<BlockKey> blocks(INPUT_COUNT);
+    for (BlockKey& key : blocks) key = { coord(rng), height(rng), coord(rng) };
+
+    // Triangles near the camera, about half of them through the near plane
+    std::vector<Triangle> triangles(INPUT_COUNT);
+    for (Triangle& tri : triangles) {
+        for (int j = 0; j < 3; j++) tri.v[j] = Vertex({ unit(rng) * 2.0f, unit(rng) * 2.0f, fNear + unit(rng) * 0.5f }, { (unit(rng) + 1.0f) * 0.5f, (unit(rng) + 1.0f) * 0.5f });
+    }
+    Vec3 nearPoint = { 0.0f, 0.0f, fNear }, nearNormal = { 0.0f, 0.0f, 1.0f };
+
+    // Faces of a frame in gather order - a square of chunks laid out the way the world stores them, seen from one corner and looking
+    // across it, so each chunk's faces are together and chunks the same distance away overlap in depth
+    std::vector<SortKey> faceKeys;
+    std::vector<SortRun> faceRuns;
+    Vec3 sortDir = Vec3(1.0f, -0.3f, 0.6f).normalize();
+    for (int cz = 0; cz < SORT_GRID; cz++) {
+        for (int cx = 0; cx < SORT_GRID; cx++) {
+            uint32_t begin = static_cast<uint32_t>(faceKeys.size());
+            for (int f = 0; f < SORT_FACES_PER_CHUNK; f++) {
+                Vec3 face = { cx * 16.0f + 8.0f + unit(rng) * 8.0f, unit(rng) * 8.0f, cz * 16.0f + 8.0f + unit(rng) * 8.0f };
+                uint32_t index = static_cast<uint32_t>(faceKeys.size());
+                faceKeys.push_back({ DepthSortKey(face.dot(sortDir)), index });
+            }
+            faceRuns.push_back({ begin, static_cast<uint32_t>(faceKeys.size()) });
+        }
+    }
+    DepthSorter sorter;
+    ScratchBuffer<SortKey> sortKeys;
+    auto depthSort = [&](DepthSortMode mode) {
+        sorter.mode = mode;
+        sorter.Reset();
+        sortKeys.Reset();
+        for (const SortKey& key : faceKeys) sortKeys.push_back(key);
+        if (mode == DepthSortMode::PerChunkMerge) {
+            for (const SortRun& r : faceRuns) sorter.runs.push_back(r);
+        }
+        sorter.Sort(sortKeys);
+    };
+
+    // Both modes have to give exactly the same order, ties included, before either is worth timing
+    depthSort(DepthSortMode::Global);
+    std::vector<SortKey> globalOrder(sortKeys.begin(), sortKeys.end());
+    depthSort(DepthSortMode::PerChunkMerge);
+    for (std::size_t i = 0; i < globalOrder.size(); i++) {
+        if (sortKeys[i].key != globalOrder[i].key || sortKeys[i].index != globalOrder[i].index) {
+            printf("Per chunk merge differs from the global sort at key %zu\n", i);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    auto run = [&](const char* name, auto op) {
+        if (filter && !strstr(name, filter)) return;
+        Result result = Measure(name, op, samples);
+        printf("%-32s %12.2f %14.0f %9.2f - %-9.2f\n", name, result.nsPerOp, 1e9 / result.nsPerOp, result.minNs, result.maxNs);
+        results.push_back(result);
+    };
+
+    printf("%-32s %12s %14s %20s\n", "kernel", "ns/op", "items/sec", "min - max ns/op");
+    run("MultiplyMatrixVector", [&](int i) {
+        Vec3 v = MultiplyMatrixVector(points[i], matProj);
+        Consume(v.x + v.y + v.z);
+    });
+    run("MatrixMultiplyMatrix", [&](int i) {
+        Mat4 m = MatrixMultiplyMatrix(matrices[i], matProj);
+        Consume(m.m[3][2] + m.m[0][0]);
+    });
+    run("MatrixPointAt", [&](int i) {
+        Mat4 m = MatrixPointAt(eyes[i], targets[i], { 0.0f, 1.0f, 0.0f });
+        Consume(m.m[0][0] + m.m[2][2]);
+    });
+    run("PerlinNoise::noise", [&](int i) {
+        Consume(static_cast<float>(perlin.noise(noisePoints[i].x, noisePoints[i].y, noisePoints[i].z)));
+    });
+    run("CastRay", [&](int i) {
+        Vec3 hit, normal;
+        if (CastRay(world, rayOrigins[i], rayDirections[i], 8.0f, hit, normal)) Consume(hit.x + normal.y);
+    });
+    run("TriangleClipAgainstPlane", [&](int i) {
+        Triangle out1, out2;
+        int count = TriangleClipAgainstPlane(nearPoint, nearNormal, triangles[i], out1, out2);
+        Consume(count > 0 ? out1.v[2].pos.z : 0.0f);
+    });
+    run("World::IsBlockAtPosition", [&](int i) {
+        sink = sink + world.IsBlockAtPosition(blocks[i].x, blocks[i].y, blocks[i].z);
+    });
+    run("BlockKeyHash", [&](int i) {
+        sink = sink + BlockKeyHash()(blocks[i]);
+    });
+    run("DepthSorter::Sort/global", [&](int) {
+        depthSort(DepthSortMode::Global);
+        sink = sink + sortKeys[0].index;
+    });
+    run("DepthSorter::Sort/merge", [&](int) {
+        depthSort(DepthSortMode::PerChunkMerge);
+        sink = sink + sortKeys[0].index;
+    });
+
+    if (outPath) {
+        if (!Save(outPath, results)) {
+            printf("Failed to write %s\n", outPath);
+            return 1;
+        }
+        printf("Saved to %s\n", outPath);
+    }
+    return 0;
+}
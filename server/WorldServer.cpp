@@ -0,0 +1,232 @@
+// WorldServer.cpp - headless authoritative world server (make server, then ./build-native/worldserver)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "PerlinNoise.hpp"
+#include "MatrixSupports.hpp"
+#include "WorldChunksBlocks.hpp"
+#include "NetSocket.hpp"
+#include "NetProtocol.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+const float SERVER_TICK_SECONDS = 1.0f / 60.0f; // Same rate as the game's simulation
+const int STATS_INTERVAL_TICKS = 60;
+const int BUILD_MARGIN_SECTIONS = 2; // Sections above and below the generated world that edits may reach
+const int MAX_MESSAGES_PER_TICK = 64; // Per client - anything more waits in its receive buffer for the next tick
+const std::size_t SEND_BACKLOG = 1 << 20; // A client with this much still unsent has nothing more handled until it catches up
+
+struct ServerClient {
+    std::unique_ptr<NetConnection> connection;
+    bool welcomed = false;
+    std::unordered_set<uint64_t> columns; // Columns the client has asked for, keyed by PackCoords(cx, 0, cz)
+};
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void RequestStop(int) { stopRequested = 1; }
+
+// Blocks clients may edit - the generated columns, and the generated height give or take BUILD_MARGIN_SECTIONS. Fixed at startup so building
+// at the edge can't move it, which would let the world (and every new client's download) grow without limit
+struct ServedBounds {
+    int columns;    // Columns along x and z
+    int extent;     // Blocks along x and z
+    int minY, maxY; // Inclusive
+
+    bool Contains(int x, int y, int z) const { return x >= 0 && x < extent && z >= 0 && z < extent && y >= minY && y <= maxY; }
+    bool ContainsColumn(int cx, int cz) const { return cx >= 0 && cx < columns && cz >= 0 && cz < columns; }
+};
+
+int Usage(const char* program) {
+    printf("Usage: %s [--port n] [--world-size columns] [--seed n] [--seconds n]\n", program);
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    // --port <n>, --world-size <columns>, --seed <n>, --seconds <n> to stop on its own
+    uint16_t port = NET_DEFAULT_PORT;
+    int worldSize = 8;
+    unsigned int seed = 1234;
+    double runSeconds = 0.0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return Usage(argv[0]); // Every option takes a value
+        if (strcmp(argv[i], "--port") == 0) port = static_cast<uint16_t>(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--world-size") == 0) worldSize = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0) seed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--seconds") == 0) runSeconds = atof(argv[++i]);
+        else return Usage(argv[0]);
+    }
+
+    World world;
+    world.SetSeed(seed);
+    world.Initialise();
+    world.worldSize = worldSize;
+    world.GeneratePerlinWorld();
+
+    ServedBounds bounds;
+    bounds.columns = world.worldSize;
+    bounds.extent = world.worldSize * world.chunkSize;
+    bounds.minY = (world.lowestSection - BUILD_MARGIN_SECTIONS) * world.chunkHeight;
+    bounds.maxY = (world.highestSection + 1 + BUILD_MARGIN_SECTIONS) * world.chunkHeight - 1;
+
+    NetListener listener;
+    if (!listener.Listen(port)) {
+        printf("Failed to listen on port %u\n", port);
+        return 1;
+    }
+    signal(SIGINT, RequestStop);
+    signal(SIGTERM, RequestStop);
+    printf("Serving a %dx%d column world (seed %u, sections %d to %d) on port %u\n", worldSize, worldSize, seed, world.lowestSection, world.highestSection, port);
+
+    std::vector<ServerClient> clients;
+    std::vector<BlockEdit> tickEdits;
+    std::vector<uint8_t> payload;
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(SERVER_TICK_SECONDS));
+    Clock::time_point start = Clock::now();
+    Clock::time_point nextTick = start;
+    uint32_t tickNumber = 0;
+    double tickTotalMs = 0.0, tickMaxMs = 0.0;
+    uint64_t sentTotal = 0, receivedTotal = 0; // Bytes from clients that have since left
+
+    while (!stopRequested) {
+        if (runSeconds > 0.0 && std::chrono::duration<double>(Clock::now() - start).count() >= runSeconds) break;
+        Clock::time_point tickStart = Clock::now();
+
+        for (int fd = listener.Accept(); fd >= 0; fd = listener.Accept()) {
+            ServerClient client;
+            client.connection.reset(new NetConnection(fd));
+            clients.push_back(std::move(client));
+        }
+
+        // Requests from every client, in the order they arrived - edits are applied right away, so whoever asked first wins.
+        // Each client gets a share of the tick, and one that isn't reading what it asked for gets nothing more until it does
+        tickEdits.clear();
+        for (ServerClient& client : clients) {
+            NetConnection& connection = *client.connection;
+            if (!connection.Receive()) continue;
+
+            uint8_t type;
+            const uint8_t* data;
+            uint32_t size;
+            for (int handled = 0; handled < MAX_MESSAGES_PER_TICK && connection.Pending() < SEND_BACKLOG && connection.NextMessage(type, data, size); handled++) {
+                NetReader reader(data, size);
+                if (type == MSG_HELLO) {
+                    if (reader.U32() != NET_PROTOCOL_VERSION) {
+                        connection.Close();
+                        break;
+                    }
+                    client.welcomed = true;
+                    payload.clear();
+                    NetWriter writer(payload);
+                    writer.I32(world.worldSize);
+                    writer.I32(world.lowestSection);
+                    writer.I32(world.highestSection);
+                    connection.Send(MSG_WELCOME, payload);
+                } else if (!client.welcomed) {
+                    connection.Close();
+                    break;
+                } else if (type == MSG_REQUEST_SECTION) {
+                    int cx = reader.I32(), cy = reader.I32(), cz = reader.I32();
+                    if (!reader.ok) continue;
+                    // Anything outside the world is answered as open air, but not followed, so a client's column set stays within the world
+                    if (bounds.ContainsColumn(cx, cz)) client.columns.insert(PackCoords(cx, 0, cz));
+                    payload.clear();
+                    WriteSectionMessage(world, cx, cy, cz, payload);
+                    connection.Send(MSG_SECTION, payload);
+                } else if (type == MSG_RELEASE_COLUMN) {
+                    int cx = reader.I32(), cz = reader.I32();
+                    if (reader.ok) client.columns.erase(PackCoords(cx, 0, cz));
+                } else if (type == MSG_EDIT) {
+                    BlockEdit edit = reader.Edit();
+                    if (!reader.ok || !bounds.Contains(edit.x, edit.y, edit.z)) continue;
+                    if (edit.added && (edit.type == static_cast<uint8_t>(BlockType::Air) || edit.type >= static_cast<uint8_t>(BlockType::Count))) continue;
+                    if (!edit.added) edit.type = static_cast<uint8_t>(world.GetBlockAt(edit.x, edit.y, edit.z));
+                    if (ApplyBlockEdit(world, edit)) tickEdits.push_back(edit);
+                }
+            }
+        }
+        world.lightEdits.clear(); // Light is each client's business
+        world.blockUpdates.clear(); // Nothing ticks or flows on the server yet
+        world.fluidUpdates.clear();
+
+        // One batch per client holding the tick's edits in its columns
+        for (ServerClient& client : clients) {
+            if (!client.welcomed || tickEdits.empty()) continue;
+            payload.clear();
+            NetWriter writer(payload);
+            writer.U32(tickNumber);
+            writer.U16(0);
+            uint16_t count = 0;
+            for (const BlockEdit& edit : tickEdits) {
+                uint64_t column = PackCoords(FloorDiv(edit.x, world.chunkSize), 0, FloorDiv(edit.z, world.chunkSize));
+                if (client.columns.find(column) == client.columns.end()) continue;
+                writer.Edit(edit);
+                if (++count == 0xFFFF) break;
+            }
+            if (count == 0) continue;
+            payload[4] = static_cast<uint8_t>(count);
+            payload[5] = static_cast<uint8_t>(count >> 8);
+            client.connection->Send(MSG_EDITS, payload);
+        }
+
+        // Write everything out and drop whoever has gone
+        for (std::size_t i = 0; i < clients.size();) {
+            NetConnection& connection = *clients[i].connection;
+            connection.Flush();
+            if (connection.IsOpen()) {
+                i++;
+                continue;
+            }
+            if (connection.Overflowed()) printf("Dropped a client that stopped reading\n");
+            sentTotal += connection.bytesSent;
+            receivedTotal += connection.bytesReceived;
+            if (i + 1 < clients.size()) clients[i] = std::move(clients.back());
+            clients.pop_back();
+        }
+
+        double tickMs = std::chrono::duration<double, std::milli>(Clock::now() - tickStart).count();
+        tickTotalMs += tickMs;
+        tickMaxMs = std::max(tickMaxMs, tickMs);
+        tickNumber++;
+
+        if (tickNumber % STATS_INTERVAL_TICKS == 0) {
+            uint64_t sent = sentTotal, received = receivedTotal;
+            for (const ServerClient& client : clients) {
+                sent += client.connection->bytesSent;
+                received += client.connection->bytesReceived;
+            }
+            float averageMs = static_cast<float>(tickTotalMs / STATS_INTERVAL_TICKS);
+            printf("Tick %u: %zu clients, %.3f ms average, %.3f ms max tick, %.1f KB sent, %.1f KB received in total\n",
+                   tickNumber, clients.size(), averageMs, tickMaxMs, sent / 1024.0, received / 1024.0);
+
+            payload.clear();
+            NetWriter writer(payload);
+            writer.U32(tickNumber);
+            writer.U32(static_cast<uint32_t>(clients.size()));
+            writer.F32(averageMs);
+            writer.F32(static_cast<float>(tickMaxMs));
+            for (ServerClient& client : clients) {
+                if (client.welcomed) client.connection->Send(MSG_STATS, payload); // Goes out with the next tick's writes
+            }
+            tickTotalMs = tickMaxMs = 0.0;
+        }
+
+        // Don't try to catch up after a long stall
+        nextTick += tick;
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > tick * 5) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+
+    printf("Stopped after %u ticks\n", tickNumber);
+    return 0;
+}
@@ -0,0 +1,94 @@
+// BlockRegistry.hpp
+#ifndef BLOCK_REGISTRY_HPP
+#define BLOCK_REGISTRY_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Block Types
+enum class BlockType : uint8_t {
+    Air = 0,
+    Stone,
+    Dirt,
+    OakWood,
+    Grass,
+    GrassSide,
+    Sand,
+    Water,
+    Lava,
+    Count
+};
+
+// Cube faces - the order matches FACE_CORNERS in ChunkMesh.hpp
+enum BlockFace : uint8_t {
+    FACE_FRONT = 0, // -Z
+    FACE_RIGHT,     // +X
+    FACE_BACK,      // +Z
+    FACE_LEFT,      // -X
+    FACE_TOP,       // +Y
+    FACE_BOTTOM,    // -Y
+    FACE_COUNT
+};
+
+// Outward normal of each face as an integer offset to the neighbouring block
+constexpr int FACE_NORMALS[FACE_COUNT][3] = {
+    { 0, 0, -1 }, { 1, 0, 0 }, { 0, 0, 1 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }
+};
+
+// Static properties of a block type
+struct BlockInfo {
+    uint8_t faceTiles[FACE_COUNT]; // Texture atlas tile index for each face
+    bool opaque;                   // Hides the faces of neighbouring blocks
+    bool solid;                    // Collides with the player and stops raycasts
+    uint8_t emission;              // Block light given off, 0-15
+};
+
+// Same tile on every face
+constexpr BlockInfo UniformBlock(uint8_t tile) {
+    return { { tile, tile, tile, tile, tile, tile }, true, true, 0 };
+}
+
+// Separate top, side and bottom tiles (e.g. Grass)
+constexpr BlockInfo ColumnBlock(uint8_t top, uint8_t side, uint8_t bottom) {
+    return { { side, side, side, side, top, bottom }, true, true, 0 };
+}
+
+// Fluids can be seen and walked through, and flow (see Fluids.hpp)
+constexpr BlockInfo FluidBlock(uint8_t tile, uint8_t emission) {
+    return { { tile, tile, tile, tile, tile, tile }, false, false, emission };
+}
+
+// Per-type traits - every BlockType must have a specialisation or the registry below will not compile
+template <BlockType T> struct BlockTraits;
+
+template <> struct BlockTraits<BlockType::Air>       { static constexpr BlockInfo info = { { 0, 0, 0, 0, 0, 0 }, false, false, 0 }; };
+template <> struct BlockTraits<BlockType::Stone>     { static constexpr BlockInfo info = UniformBlock(0); };
+template <> struct BlockTraits<BlockType::Dirt>      { static constexpr BlockInfo info = UniformBlock(1); };
+template <> struct BlockTraits<BlockType::OakWood>   { static constexpr BlockInfo info = UniformBlock(2); };
+template <> struct BlockTraits<BlockType::Grass>     { static constexpr BlockInfo info = ColumnBlock(3, 4, 1); };
+template <> struct BlockTraits<BlockType::GrassSide> { static constexpr BlockInfo info = UniformBlock(4); };
+template <> struct BlockTraits<BlockType::Sand>      { static constexpr BlockInfo info = UniformBlock(5); };
+template <> struct BlockTraits<BlockType::Water>     { static constexpr BlockInfo info = FluidBlock(6, 0); };
+template <> struct BlockTraits<BlockType::Lava>      { static constexpr BlockInfo info = FluidBlock(7, 15); };
+
+// Registry indexed by BlockType
+constexpr BlockInfo BLOCK_REGISTRY[] = {
+    BlockTraits<BlockType::Air>::info,
+    BlockTraits<BlockType::Stone>::info,
+    BlockTraits<BlockType::Dirt>::info,
+    BlockTraits<BlockType::OakWood>::info,
+    BlockTraits<BlockType::Grass>::info,
+    BlockTraits<BlockType::GrassSide>::info,
+    BlockTraits<BlockType::Sand>::info,
+    BlockTraits<BlockType::Water>::info,
+    BlockTraits<BlockType::Lava>::info
+};
+
+static_assert(sizeof(BLOCK_REGISTRY) / sizeof(BLOCK_REGISTRY[0]) == static_cast<std::size_t>(BlockType::Count),
+              "BLOCK_REGISTRY needs an entry for every BlockType");
+
+inline const BlockInfo& GetBlockInfo(BlockType type) { return BLOCK_REGISTRY[static_cast<std::size_t>(type)]; }
+inline uint8_t GetBlockTile(BlockType type, int face) { return BLOCK_REGISTRY[static_cast<std::size_t>(type)].faceTiles[face]; }
+inline bool IsFluid(BlockType type) { return type == BlockType::Water || type == BlockType::Lava; }
+
+#endif
@@ -0,0 +1,124 @@
+// BlockStorage.hpp
+#ifndef BLOCK_STORAGE_HPP
+#define BLOCK_STORAGE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "BlockRegistry.hpp"
+
+// Block types of every voxel in a chunk, palette compressed. A chunk of one type (solid stone, open sky) stores just that type.
+// Otherwise each voxel is a 1, 2, 4 or 8 bit index into a small palette, packed into 32 bit words so an entry never straddles two,
+// and the indices are widened when an edit brings in one type more than they can address
+class BlockStorage {
+public:
+    // Size the storage and fill every voxel with one type
+    void Reset(int count, BlockType fill) {
+        size = count;
+        bits = 0;
+        palette.assign(1, fill);
+        words.clear();
+        words.shrink_to_fit();
+    }
+
+    BlockType Get(int i) const {
+        if (bits == 0) return palette[0];
+        int bit = i * bits;
+        return palette[(words[bit >> 5] >> (bit & 31)) & ((1u << bits) - 1)];
+    }
+
+    void Set(int i, BlockType type) {
+        int entry = PaletteEntry(type);
+        if (entry < 0) {
+            palette.push_back(type);
+            entry = static_cast<int>(palette.size() - 1);
+            if (entry >= (1 << bits)) Widen(bits == 0 ? 1 : bits * 2);
+        }
+        if (bits == 0) return; // Setting a uniform chunk to its own type
+
+        int bit = i * bits;
+        uint32_t mask = ((1u << bits) - 1) << (bit & 31);
+        uint32_t& word = words[bit >> 5];
+        word = (word & ~mask) | (static_cast<uint32_t>(entry) << (bit & 31));
+    }
+
+    bool IsUniform() const { return bits == 0; }
+    BlockType UniformType() const { return palette[0]; } // Only meaningful when IsUniform()
+
+    // False if no voxel is of this type. Can be true for a type that has since been edited away, until Compact()
+    bool MayContain(BlockType type) const { return PaletteEntry(type) >= 0; }
+
+    // Drop palette entries no voxel uses any more and narrow the indices to fit - collapses to a single value if only one type is left.
+    // Worth calling after filling a chunk in, since generation starts from an all air chunk
+    void Compact() {
+        if (bits == 0) return;
+
+        std::vector<int> counts(palette.size(), 0);
+        for (int i = 0; i < size; i++) counts[RawEntry(i)]++;
+
+        std::vector<BlockType> used;
+        std::vector<int> remap(palette.size(), -1);
+        for (std::size_t e = 0; e < palette.size(); e++) {
+            if (counts[e] == 0) continue;
+            remap[e] = static_cast<int>(used.size());
+            used.push_back(palette[e]);
+        }
+
+        if (used.size() == 1) {
+            Reset(size, used[0]);
+            return;
+        }
+
+        int newBits = 1;
+        while ((1 << newBits) < static_cast<int>(used.size())) newBits *= 2;
+
+        std::vector<uint32_t> packed(WordCount(newBits), 0);
+        for (int i = 0; i < size; i++) {
+            int bit = i * newBits;
+            packed[bit >> 5] |= static_cast<uint32_t>(remap[RawEntry(i)]) << (bit & 31);
+        }
+        palette.swap(used);
+        palette.shrink_to_fit();
+        words.swap(packed);
+        bits = newBits;
+    }
+
+    // Heap and inline bytes held for this chunk's blocks
+    std::size_t MemoryUsage() const {
+        return sizeof(*this) + palette.capacity() * sizeof(BlockType) + words.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    int PaletteEntry(BlockType type) const {
+        for (std::size_t e = 0; e < palette.size(); e++) {
+            if (palette[e] == type) return static_cast<int>(e);
+        }
+        return -1;
+    }
+
+    int RawEntry(int i) const {
+        int bit = i * bits;
+        return static_cast<int>((words[bit >> 5] >> (bit & 31)) & ((1u << bits) - 1));
+    }
+
+    std::size_t WordCount(int entryBits) const { return (static_cast<std::size_t>(size) * entryBits + 31) / 32; }
+
+    // Repack every index at a wider size - a uniform chunk becomes all zeroes, which is its old single value
+    void Widen(int newBits) {
+        std::vector<uint32_t> packed(WordCount(newBits), 0);
+        if (bits > 0) {
+            for (int i = 0; i < size; i++) {
+                int bit = i * newBits;
+                packed[bit >> 5] |= static_cast<uint32_t>(RawEntry(i)) << (bit & 31);
+            }
+        }
+        words.swap(packed);
+        bits = newBits;
+    }
+
+    int size = 0;
+    int bits = 0; // 0 while the chunk is one type
+    std::vector<BlockType> palette;
+    std::vector<uint32_t> words;
+};
+
+#endif
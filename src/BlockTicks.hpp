@@ -0,0 +1,149 @@
+// BlockTicks.hpp
+#ifndef BLOCK_TICKS_HPP
+#define BLOCK_TICKS_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+#include "WorldChunksBlocks.hpp"
+
+// Per-block simulation, without ever walking the whole world:
+// - Random ticks - every section near the player has a few voxels picked at random each tick, and those whose type reacts to it do.
+//   Sections whose palette holds no such type are skipped without looking at their blocks
+// - Scheduled ticks - a block that has to act after something next to it changed (sand losing what held it up) is queued for a later tick.
+//   The queue is ordered by due tick and worked through up to a limit per tick, so a big collapse is spread out rather than stalling
+// Everything runs off the tick count and a seeded generator, never the clock, so a replay ticks exactly as the recording did
+const int SIMULATION_DISTANCE = 4;      // Columns either side of the player's own that get random ticks
+const int RANDOM_TICKS_PER_SECTION = 1; // Voxels picked in each of those sections per tick
+const int MAX_SCHEDULED_PER_TICK = 256; // Scheduled ticks run per tick - any more that are due wait for the next
+const uint32_t FALL_DELAY_TICKS = 2;    // Ticks between sand losing its support and dropping a block
+
+class BlockTicker {
+public:
+    explicit BlockTicker(World& world) : world(world) {}
+
+    // Drop everything queued and restart the tick count and random sequence - call once the world has been generated
+    void Reset(unsigned int seed) {
+        queue = {};
+        pending.clear();
+        world.blockUpdates.clear();
+        tickNumber = 0;
+        nextOrder = 0;
+        randomState = seed;
+    }
+
+    // Queue a scheduled tick for a position, unless it already has one waiting
+    void Schedule(int x, int y, int z, uint32_t delay) {
+        if (!pending.insert({ x, y, z }).second) return;
+        queue.push({ tickNumber + delay, nextOrder++, { x, y, z } });
+    }
+
+    // Advance one simulation tick, with random ticks centred on the player's position
+    void Update(const Vec3& centre) {
+        // Whatever was edited since the last tick, and the blocks next to it, may need to react
+        for (const BlockKey& edit : world.blockUpdates) {
+            ScheduleIfNeeded(edit.x, edit.y, edit.z);
+            for (int f = 0; f < FACE_COUNT; f++) ScheduleIfNeeded(edit.x + FACE_NORMALS[f][0], edit.y + FACE_NORMALS[f][1], edit.z + FACE_NORMALS[f][2]);
+        }
+        world.blockUpdates.clear();
+
+        RandomTicks(FloorDiv(static_cast<int>(floorf(centre.x)), world.chunkSize), FloorDiv(static_cast<int>(floorf(centre.z)), world.chunkSize));
+
+        // Due ticks in the order they were scheduled. Their own edits are picked up at the start of the next tick
+        for (int run = 0; run < MAX_SCHEDULED_PER_TICK && !queue.empty() && queue.top().due <= tickNumber; run++) {
+            BlockKey pos = queue.top().pos;
+            queue.pop();
+            pending.erase(pos);
+            ScheduledTick(pos.x, pos.y, pos.z);
+            scheduledTicks++;
+        }
+        tickNumber++;
+    }
+
+    std::size_t Scheduled() const { return queue.size(); }
+
+    uint64_t randomTicks = 0;     // Random ticks that landed on a block that reacts to them
+    uint64_t scheduledTicks = 0;  // Scheduled ticks run
+    uint64_t sectionsSampled = 0; // Sections that had voxels picked for random ticks
+
+private:
+    struct Entry {
+        uint32_t due;
+        uint32_t order; // Keeps ticks due together in the order they were scheduled
+        BlockKey pos;
+
+        // Makes std::priority_queue put the earliest first
+        bool operator<(const Entry& other) const { return due != other.due ? due > other.due : order > other.order; }
+    };
+
+    // SplitMix64 - its own sequence, so the world's ticks don't depend on anything else drawing random numbers
+    uint32_t NextRandom() {
+        randomState += 0x9E3779B97F4A7C15ull;
+        return static_cast<uint32_t>(MixHash64(randomState) >> 32);
+    }
+
+    void ScheduleIfNeeded(int x, int y, int z) {
+        if (world.GetBlockAt(x, y, z) == BlockType::Sand) Schedule(x, y, z, FALL_DELAY_TICKS);
+    }
+
+    void RandomTicks(int centreX, int centreZ) {
+        for (int cz = centreZ - SIMULATION_DISTANCE; cz <= centreZ + SIMULATION_DISTANCE; cz++) {
+            for (int cx = centreX - SIMULATION_DISTANCE; cx <= centreX + SIMULATION_DISTANCE; cx++) {
+                for (int cy = world.lowestSection; cy <= world.highestSection; cy++) {
+                    const Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+                    if (!chunk || !chunk->blocks.MayContain(BlockType::Grass)) continue;
+                    sectionsSampled++;
+
+                    // Copied out first - a tick's edits can add sections, which moves the chunks
+                    int sizeX = chunk->sizeX, sizeZ = chunk->sizeZ, count = chunk->VoxelCount();
+                    int ox = static_cast<int>(chunk->offset.x), oy = static_cast<int>(chunk->offset.y), oz = static_cast<int>(chunk->offset.z);
+                    for (int t = 0; t < RANDOM_TICKS_PER_SECTION; t++) {
+                        int i = static_cast<int>(NextRandom() % static_cast<uint32_t>(count));
+                        int x = ox + i % sizeX;
+                        int z = oz + (i / sizeX) % sizeZ;
+                        int y = oy + i / (sizeX * sizeZ);
+                        RandomTick(x, y, z);
+                    }
+                }
+            }
+        }
+    }
+
+    // Grass dies under anything opaque, and otherwise spreads to dirt around it that has open space above
+    void RandomTick(int x, int y, int z) {
+        if (world.GetBlockAt(x, y, z) != BlockType::Grass) return;
+        randomTicks++;
+
+        if (world.IsOpaqueBlockAt(x, y + 1, z)) {
+            world.SetBlockAtPosition(x, y, z, BlockType::Dirt);
+            return;
+        }
+
+        uint32_t r = NextRandom();
+        int tx = x + static_cast<int>(r % 3) - 1;
+        int ty = y + static_cast<int>(r / 3 % 3) - 1;
+        int tz = z + static_cast<int>(r / 9 % 3) - 1;
+        if (world.GetBlockAt(tx, ty, tz) == BlockType::Dirt && !world.IsOpaqueBlockAt(tx, ty + 1, tz)) world.SetBlockAtPosition(tx, ty, tz, BlockType::Grass);
+    }
+
+    // Sand with air or fluid under it drops one block, pushing the fluid out of the way - moving it is an edit at both ends, which schedules it again, and the sand above it
+    void ScheduledTick(int x, int y, int z) {
+        if (world.GetBlockAt(x, y, z) != BlockType::Sand) return; // Changed since it was queued
+        if (y <= world.lowestSection * world.chunkHeight) return; // Resting on the bottom of the world
+        if (world.IsSolidBlockAt(x, y - 1, z)) return;
+
+        world.SetBlockAtPosition(x, y, z, BlockType::Air);
+        world.SetBlockAtPosition(x, y - 1, z, BlockType::Sand);
+    }
+
+    World& world;
+    std::priority_queue<Entry> queue;
+    std::unordered_set<BlockKey, BlockKeyHash> pending; // Positions in the queue
+    uint32_t tickNumber = 0;
+    uint32_t nextOrder = 0;
+    uint64_t randomState = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+// ChunkMap.hpp
+#ifndef CHUNK_MAP_HPP
+#define CHUNK_MAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+// Pack three signed coordinates into 64 bits (21 bits each, enough for +/- one million)
+inline uint64_t PackCoords(int x, int y, int z) {
+    const uint64_t mask = (1ull << 21) - 1;
+    return (static_cast<uint64_t>(x) & mask) | ((static_cast<uint64_t>(y) & mask) << 21) | ((static_cast<uint64_t>(z) & mask) << 42);
+}
+
+// SplitMix64 finaliser - spreads small neighbouring integers across the whole table
+inline uint64_t MixHash64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+// Open-addressing hash table from packed chunk coordinates to an index into World::chunks. Chunks are never removed, so there are no tombstones
+class ChunkMap {
+public:
+    ChunkMap() { Rehash(64); }
+
+    // Returns -1 if there is no chunk at the coordinates
+    int Find(uint64_t key) const {
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = MixHash64(key) & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.index < 0) return -1;
+            if (slot.key == key) return slot.index;
+        }
+    }
+
+    void Insert(uint64_t key, int index) {
+        // Keep the load factor at or below one half so probe runs stay short
+        if ((count + 1) * 2 > slots.size()) Rehash(slots.size() * 2);
+        Place(key, index);
+        count++;
+    }
+
+    std::size_t Size() const { return count; }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        int index = -1;
+    };
+
+    void Place(uint64_t key, int index) {
+        std::size_t mask = slots.size() - 1;
+        std::size_t i = MixHash64(key) & mask;
+        while (slots[i].index >= 0 && slots[i].key != key) i = (i + 1) & mask;
+        slots[i].key = key;
+        slots[i].index = index;
+    }
+
+    void Rehash(std::size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(capacity, Slot());
+        for (const Slot& slot : old) {
+            if (slot.index >= 0) Place(slot.key, slot.index);
+        }
+    }
+
+    std::vector<Slot> slots;
+    std::size_t count = 0;
+};
+
+#endif
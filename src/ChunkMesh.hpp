@@ -0,0 +1,200 @@
+// ChunkMesh.hpp
+#ifndef CHUNK_MESH_HPP
+#define CHUNK_MESH_HPP
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "WorldChunksBlocks.hpp"
+#include "Lighting.hpp"
+
+// Corners of each face, as seen from outside the block: bottom-left, top-left, top-right, bottom-right.
+// Triangle 0 uses corners 0, 1, 2 and triangle 1 uses corners 0, 2, 3
+constexpr uint8_t FACE_CORNERS[FACE_COUNT][4][3] = {
+    { { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 } }, // Front
+    { { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 }, { 1, 0, 1 } }, // Right
+    { { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 }, { 0, 0, 1 } }, // Back
+    { { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 }, { 0, 0, 0 } }, // Left
+    { { 0, 1, 0 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 } }, // Top
+    { { 0, 0, 1 }, { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 } }  // Bottom
+};
+constexpr uint8_t TRI_CORNERS[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+
+// Texture coordinate of each face corner - the top face's texture is turned a quarter relative to the sides
+constexpr uint8_t FACE_UVS[FACE_COUNT][4][2] = {
+    { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // Front
+    { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // Right
+    { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // Back
+    { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }, // Left
+    { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } }, // Top
+    { { 0, 1 }, { 0, 0 }, { 1, 0 }, { 1, 1 } }  // Bottom
+};
+
+// Brightness for each light level - roughly 0.8 per level down from full
+constexpr uint8_t LIGHT_CURVE[MAX_LIGHT + 1] = { 46, 48, 50, 53, 57, 62, 67, 75, 84, 95, 109, 127, 149, 177, 212, 255 };
+
+// Ambient occlusion darkening, indexed by how many of the three neighbouring cells are open (0 = tucked in a corner)
+constexpr uint8_t AO_CURVE[4] = { 140, 179, 217, 255 };
+
+// One exposed block face
+struct MeshFace {
+    uint8_t face; // BlockFace
+    uint8_t tile; // Texture atlas tile
+};
+
+// Face corner in chunk-local integer coordinates (0 to the chunk size inclusive) - add the mesh offset for world space
+struct MeshVertex {
+    uint8_t x, y, z;
+    uint8_t u, v;  // Corner of the tile, 0 or 1
+    uint8_t shade; // Baked light and ambient occlusion, 255 = full brightness
+};
+
+// Exposed faces of one chunk - immutable once built, so the render thread can hold it by handle while the world keeps changing
+struct ChunkMesh {
+    Vec3 offset;
+    Vec3 centre;  // Bounding sphere, used for culling
+    float radius;
+    std::vector<MeshFace> faces;      // Grouped by direction - the faces pointing along BlockFace f are bucketStart[f] to bucketStart[f + 1]
+    std::vector<MeshVertex> vertices; // Four per face, in FACE_CORNERS order
+    uint32_t bucketStart[FACE_COUNT + 1] = {};
+};
+
+// Copy of a chunk's blocks plus a one block border from its neighbours - everything a mesh build needs, so the build can run on a worker thread
+struct ChunkVolume {
+    Vec3 offset;
+    int sizeX = 0, sizeY = 0, sizeZ = 0; // Chunk size - the volume is two larger on each axis
+    std::vector<BlockType> blocks;
+    std::vector<uint8_t> light; // Packed sky/block light, same layout as blocks
+
+    // Chunk-local coordinates, -1 to size inclusive
+    int Index(int x, int y, int z) const { return ((y + 1) * (sizeZ + 2) + (z + 1)) * (sizeX + 2) + (x + 1); }
+    BlockType At(int x, int y, int z) const { return blocks[Index(x, y, z)]; }
+    bool OpaqueAt(int x, int y, int z) const { return GetBlockInfo(blocks[Index(x, y, z)]).opaque; }
+
+    // Brighter of the two light channels
+    uint8_t LightAt(int x, int y, int z) const {
+        uint8_t packed = light[Index(x, y, z)];
+        return std::max(SkyLight(packed), BlockLight(packed));
+    }
+};
+
+// Snapshot the blocks a chunk's mesh depends on. Runs on the simulation thread - it copies straight out of the neighbouring chunks' storage
+std::shared_ptr<ChunkVolume> CaptureChunkVolume(const World& world, const Chunk& chunk) {
+    auto volume = std::make_shared<ChunkVolume>();
+    volume->offset = chunk.offset;
+    volume->sizeX = chunk.sizeX;
+    volume->sizeY = chunk.sizeY;
+    volume->sizeZ = chunk.sizeZ;
+    volume->blocks.assign((chunk.sizeX + 2) * (chunk.sizeY + 2) * (chunk.sizeZ + 2), BlockType::Air);
+    volume->light.assign(volume->blocks.size(), OPEN_AIR_LIGHT);
+
+    int ox = static_cast<int>(chunk.offset.x);
+    int oy = static_cast<int>(chunk.offset.y);
+    int oz = static_cast<int>(chunk.offset.z);
+
+    // The padded box only reaches into the 26 neighbouring chunks
+    int cx = FloorDiv(ox, world.chunkSize);
+    int cy = FloorDiv(oy, world.chunkHeight);
+    int cz = FloorDiv(oz, world.chunkSize);
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                const Chunk* other = world.GetChunkByCoords(cx + dx, cy + dy, cz + dz);
+                if (!other) continue;
+
+                // Blocks and light for the part of the padded box that falls inside this chunk
+                int ax = (cx + dx) * world.chunkSize - ox;
+                int ay = (cy + dy) * world.chunkHeight - oy;
+                int az = (cz + dz) * world.chunkSize - oz;
+                for (int y = std::max(-1, ay); y <= std::min(chunk.sizeY, ay + other->sizeY - 1); y++) {
+                    for (int z = std::max(-1, az); z <= std::min(chunk.sizeZ, az + other->sizeZ - 1); z++) {
+                        for (int x = std::max(-1, ax); x <= std::min(chunk.sizeX, ax + other->sizeX - 1); x++) {
+                            int i = other->VoxelIndex(x - ax, y - ay, z - az);
+                            volume->blocks[volume->Index(x, y, z)] = other->blocks.Get(i);
+                            volume->light[volume->Index(x, y, z)] = other->light[i];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return volume;
+}
+
+// Shade of one face corner - light averaged over the open cells around the corner in front of the face, darkened by ambient occlusion
+uint8_t CornerShade(const ChunkVolume& volume, int x, int y, int z, int f, int corner) {
+    const int* n = FACE_NORMALS[f];
+    const uint8_t* c = FACE_CORNERS[f][corner];
+
+    // Cell in front of the face, and steps towards the corner along the face's two in-plane axes
+    int ax = x + n[0], ay = y + n[1], az = z + n[2];
+    int u[3] = { 0, 0, 0 }, v[3] = { 0, 0, 0 };
+    int axis = 0;
+    for (int i = 0; i < 3; i++) {
+        if (n[i] != 0) continue;
+        int step = c[i] ? 1 : -1;
+        if (axis++ == 0) u[i] = step; else v[i] = step;
+    }
+
+    bool side1 = volume.OpaqueAt(ax + u[0], ay + u[1], az + u[2]);
+    bool side2 = volume.OpaqueAt(ax + v[0], ay + v[1], az + v[2]);
+    bool diagonal = volume.OpaqueAt(ax + u[0] + v[0], ay + u[1] + v[1], az + u[2] + v[2]);
+    int ao = (side1 && side2) ? 0 : 3 - (side1 + side2 + diagonal);
+
+    int sum = volume.LightAt(ax, ay, az);
+    int count = 1;
+    if (!side1) { sum += volume.LightAt(ax + u[0], ay + u[1], az + u[2]); count++; }
+    if (!side2) { sum += volume.LightAt(ax + v[0], ay + v[1], az + v[2]); count++; }
+    if (!diagonal && ao > 0) { sum += volume.LightAt(ax + u[0] + v[0], ay + u[1] + v[1], az + u[2] + v[2]); count++; }
+    int level = (sum + count / 2) / count;
+
+    return static_cast<uint8_t>(LIGHT_CURVE[level] * AO_CURVE[ao] / 255);
+}
+
+// Collect every face of the chunk that is not hidden by an opaque neighbour. Only reads the volume, so it is safe on any thread
+std::shared_ptr<const ChunkMesh> BuildChunkMesh(const ChunkVolume& volume) {
+    auto mesh = std::make_shared<ChunkMesh>();
+    Vec3 halfSize(volume.sizeX * 0.5f, volume.sizeY * 0.5f, volume.sizeZ * 0.5f);
+    mesh->offset = volume.offset;
+    mesh->centre = volume.offset + halfSize;
+    mesh->radius = sqrtf(halfSize.dot(halfSize));
+
+    for (int f = 0; f < FACE_COUNT; f++) {
+        mesh->bucketStart[f] = static_cast<uint32_t>(mesh->faces.size());
+        for (int y = 0; y < volume.sizeY; y++) {
+            for (int z = 0; z < volume.sizeZ; z++) {
+                for (int x = 0; x < volume.sizeX; x++) {
+                    BlockType type = volume.At(x, y, z);
+                    if (type == BlockType::Air) continue;
+                    const BlockInfo& info = GetBlockInfo(type);
+
+                    // Skip the face if an opaque block is next to it, or more of the same see-through block (the inside of a lake)
+                    BlockType neighbour = volume.At(x + FACE_NORMALS[f][0], y + FACE_NORMALS[f][1], z + FACE_NORMALS[f][2]);
+                    if (GetBlockInfo(neighbour).opaque || neighbour == type) continue;
+
+                    MeshFace face;
+                    face.face = static_cast<uint8_t>(f);
+                    face.tile = info.faceTiles[f];
+                    mesh->faces.push_back(face);
+
+                    for (int corner = 0; corner < 4; corner++) {
+                        const uint8_t* c = FACE_CORNERS[f][corner];
+                        MeshVertex vertex;
+                        vertex.x = static_cast<uint8_t>(x + c[0]);
+                        vertex.y = static_cast<uint8_t>(y + c[1]);
+                        vertex.z = static_cast<uint8_t>(z + c[2]);
+                        vertex.u = FACE_UVS[f][corner][0];
+                        vertex.v = FACE_UVS[f][corner][1];
+                        vertex.shade = CornerShade(volume, x, y, z, f, corner);
+                        mesh->vertices.push_back(vertex);
+                    }
+                }
+            }
+        }
+    }
+    mesh->bucketStart[FACE_COUNT] = static_cast<uint32_t>(mesh->faces.size());
+    return mesh;
+}
+
+#endif
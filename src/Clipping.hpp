@@ -0,0 +1,143 @@
+// Clipping.hpp
+#ifndef CLIPPING_HPP
+#define CLIPPING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Point where the line between two vertices crosses a plane, with its texture coordinate and light interpolated to match
+Vertex IntersectPlane(const Vec3 &plane_p, const Vec3 &plane_n, const Vertex &lineStart, const Vertex &lineEnd, float &t) {
+    Vec3 plane_n_norm = plane_n.normalize();
+    float plane_d = -plane_n_norm.dot(plane_p);
+    float ad = lineStart.pos.dot(plane_n_norm);
+    float bd = lineEnd.pos.dot(plane_n_norm);
+    float denominator = bd - ad;
+    if (fabs(denominator) < 1e-6f) {
+        t = 0.0f;
+        return lineStart;
+    }
+    t = (-plane_d - ad) / denominator;
+    Vec3 lineStartToEnd = lineEnd.pos - lineStart.pos;
+    Vec3 intersectionPoint = lineStart.pos + lineStartToEnd * t;
+
+    Vec2 texStartToEnd = lineEnd.tex - lineStart.tex;
+    Vec2 intersectionTex = lineStart.tex + texStartToEnd * t;
+
+    Vertex intersection(intersectionPoint, intersectionTex);
+    intersection.light = lineStart.light + (lineEnd.light - lineStart.light) * t;
+    return intersection;
+}
+
+// Clipping triangle against near plane (returns the number of output triangles)
+int TriangleClipAgainstPlane(const Vec3 &plane_p, const Vec3 &plane_n, const Triangle &inTri, Triangle &outTri1, Triangle &outTri2) {
+    Vec3 plane_n_norm = plane_n.normalize();
+
+    auto dist = [&](const Vertex &v) {
+        Vec3 n = v.pos - plane_p;
+        return plane_n_norm.dot(n);
+    };
+
+    const Vertex *inside_points[3];  int nInsidePointCount = 0;
+    const Vertex *outside_points[3]; int nOutsidePointCount = 0;
+
+    float d0 = dist(inTri.v[0]);
+    float d1 = dist(inTri.v[1]);
+    float d2 = dist(inTri.v[2]);
+
+    if (d0 >= 0) inside_points[nInsidePointCount++] = &inTri.v[0]; else outside_points[nOutsidePointCount++] = &inTri.v[0];
+    if (d1 >= 0) inside_points[nInsidePointCount++] = &inTri.v[1]; else outside_points[nOutsidePointCount++] = &inTri.v[1];
+    if (d2 >= 0) inside_points[nInsidePointCount++] = &inTri.v[2]; else outside_points[nOutsidePointCount++] = &inTri.v[2];
+
+    if (nInsidePointCount == 0)  return 0;
+
+    float t;
+    if (nInsidePointCount == 3) {
+        outTri1 = inTri;
+        return 1;
+    }
+
+    if (nInsidePointCount == 1 && nOutsidePointCount == 2) {
+        outTri1.v[0] = *inside_points[0];
+        outTri1.v[1] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[0], t);
+        outTri1.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[1], t);
+        return 1;
+    }
+
+    if (nInsidePointCount == 2 && nOutsidePointCount == 1) {
+        outTri1.v[0] = *inside_points[0];
+        outTri1.v[1] = *inside_points[1];
+        outTri1.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[0], t);
+
+        outTri2.v[0] = *inside_points[1];
+        outTri2.v[1] = outTri1.v[2];
+        outTri2.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[1], *outside_points[0], t);
+        return 2;
+    }
+
+    return 0;
+}
+
+// View-space clipping. Triangles wholly off one side of the view frustum are dropped, and the rest are drawn unclipped unless they reach
+// past the near plane or out of the guard band - a frustum this many times wider than the screen, inside which the rasteriser's own
+// scissoring is cheaper than clipping and screen coordinates stay small
+const float GUARD_BAND_SCALE = 4.0f;
+const int MAX_CLIPPED_TRIANGLES = 32; // Enough for one triangle split by every plane
+
+enum ClipPlane : uint8_t { CLIP_NEAR = 0, CLIP_LEFT, CLIP_RIGHT, CLIP_TOP, CLIP_BOTTOM, CLIP_PLANE_COUNT };
+
+struct ViewClipper {
+    Vec3 planePos[CLIP_PLANE_COUNT];
+    Vec3 viewNormal[CLIP_PLANE_COUNT];  // Inward normals of the frustum's sides
+    Vec3 guardNormal[CLIP_PLANE_COUNT]; // Inward normals of the guard band's sides
+
+    // xScale and yScale are the projection's x and y scale, so the screen edges are where x * xScale or y * yScale equals z
+    void Setup(float xScale, float yScale, float nearZ) {
+        for (int side = 0; side < 2; side++) {
+            float guard = side ? GUARD_BAND_SCALE : 1.0f;
+            Vec3* normals = side ? guardNormal : viewNormal;
+            normals[CLIP_NEAR] = { 0.0f, 0.0f, 1.0f };
+            normals[CLIP_LEFT] = { xScale / guard, 0.0f, 1.0f };
+            normals[CLIP_RIGHT] = { -xScale / guard, 0.0f, 1.0f };
+            normals[CLIP_TOP] = { 0.0f, -yScale / guard, 1.0f };
+            normals[CLIP_BOTTOM] = { 0.0f, yScale / guard, 1.0f };
+        }
+        for (int p = 0; p < CLIP_PLANE_COUNT; p++) planePos[p] = { 0.0f, 0.0f, 0.0f };
+        planePos[CLIP_NEAR] = { 0.0f, 0.0f, nearZ };
+    }
+
+    // One bit per plane the point is outside of
+    uint8_t Outcode(const Vec3& p, const Vec3* normals) const {
+        uint8_t code = 0;
+        for (int i = 0; i < CLIP_PLANE_COUNT; i++) {
+            if ((p - planePos[i]).dot(normals[i]) < 0.0f) code |= 1 << i;
+        }
+        return code;
+    }
+    uint8_t ViewOutcode(const Vec3& p) const { return Outcode(p, viewNormal); }
+    uint8_t GuardOutcode(const Vec3& p) const { return Outcode(p, guardNormal); }
+
+    // Clip a view-space triangle against the guard band planes in mask. Returns the number of triangles written to out
+    int Clip(const Triangle& tri, uint8_t mask, Triangle* out) const {
+        Triangle scratch[MAX_CLIPPED_TRIANGLES];
+        Triangle* from = out;
+        Triangle* to = scratch;
+        int count = 1;
+        from[0] = tri;
+
+        for (int p = 0; p < CLIP_PLANE_COUNT && count > 0; p++) {
+            if (!(mask & (1 << p))) continue;
+            int next = 0;
+            for (int i = 0; i < count && next + 2 <= MAX_CLIPPED_TRIANGLES; i++) {
+                next += TriangleClipAgainstPlane(planePos[p], guardNormal[p], from[i], to[next], to[next + 1]);
+            }
+            std::swap(from, to);
+            count = next;
+        }
+
+        if (from != out) std::copy(from, from + count, out);
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+// DepthSort.hpp
+#ifndef DEPTH_SORT_HPP
+#define DEPTH_SORT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "FrameMemory.hpp"
+
+// Depth key and index into the per-frame triangle list - this is what gets sorted for the painter's algorithm
+struct SortKey {
+    uint32_t key;
+    uint32_t index;
+};
+
+// Contiguous range of keys belonging to one chunk
+struct SortRun {
+    uint32_t begin, end;
+};
+
+enum class DepthSortMode {
+    Global,       // One radix sort over every key
+    PerChunkMerge // Sort each chunk's run on its own, put the runs in depth order and merge only where they overlap. Gives the same order as
+                  // Global, but chunks side by side across the view overlap in depth, so most keys still go through the heap - slower, for checking
+};
+
+// Depth quantisation - 24 bit keys at 1/1024 of a block, covering depths from -8192 to +8192
+const int DEPTH_KEY_BITS = 24;
+const uint32_t DEPTH_KEY_MAX = (1u << DEPTH_KEY_BITS) - 1;
+const float DEPTH_KEY_SCALE = 1024.0f;
+const float DEPTH_KEY_MIN = -8192.0f;
+
+// Quantise a depth into a key where ascending order is far to near
+inline uint32_t DepthSortKey(float depth) {
+    float q = (depth - DEPTH_KEY_MIN) * DEPTH_KEY_SCALE;
+    if (q < 0.0f) q = 0.0f;
+    if (q > static_cast<float>(DEPTH_KEY_MAX)) q = static_cast<float>(DEPTH_KEY_MAX);
+    return DEPTH_KEY_MAX - static_cast<uint32_t>(q);
+}
+
+// LSD radix sort over the low DEPTH_KEY_BITS of each key, 8 bits per pass. Stable, so equal depths keep their order from frame to frame
+void RadixSortKeys(SortKey* keys, SortKey* temp, std::size_t n) {
+    if (n < 2) return;
+
+    SortKey* src = keys;
+    SortKey* dst = temp;
+    for (int shift = 0; shift < DEPTH_KEY_BITS; shift += 8) {
+        uint32_t counts[256] = {0};
+        for (std::size_t i = 0; i < n; i++) counts[(src[i].key >> shift) & 0xFF]++;
+
+        // Skip passes where every key has the same digit
+        if (counts[(src[0].key >> shift) & 0xFF] == n) continue;
+
+        uint32_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            uint32_t c = counts[b];
+            counts[b] = sum;
+            sum += c;
+        }
+        for (std::size_t i = 0; i < n; i++) dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+        std::swap(src, dst);
+    }
+
+    if (src != keys) std::copy(src, src + n, keys);
+}
+
+// Insertion sort for keys that are already nearly sorted (e.g. last frame's order). Gives up and returns false after maxMoves shifts
+bool InsertionSortKeys(SortKey* keys, std::size_t n, std::size_t maxMoves) {
+    std::size_t moves = 0;
+    for (std::size_t i = 1; i < n; i++) {
+        SortKey k = keys[i];
+        std::size_t j = i;
+        while (j > 0 && keys[j - 1].key > k.key) {
+            keys[j] = keys[j - 1];
+            j--;
+            if (++moves > maxMoves) {
+                keys[j] = k;
+                return false;
+            }
+        }
+        keys[j] = k;
+    }
+    return true;
+}
+
+// Owns the reusable buffers for depth sorting
+struct DepthSorter {
+    DepthSortMode mode = DepthSortMode::Global;
+    ScratchBuffer<SortKey> temp;
+    ScratchBuffer<SortRun> runs; // Filled by the caller when using PerChunkMerge - the runs must be in order and cover every key
+    ScratchBuffer<SortKey> order; // Runs by their farthest key - key is that key, index is the run
+    ScratchBuffer<SortKey> heap;  // Merge heap - key is the run's head key, index is the run
+
+    void Reset() {
+        runs.Reset();
+    }
+
+    void Sort(ScratchBuffer<SortKey>& keys) {
+        std::size_t n = keys.size();
+        temp.Reset();
+        temp.items.resize(n);
+
+        if (mode == DepthSortMode::Global || runs.size() < 2) {
+            RadixSortKeys(keys.items.data(), temp.items.data(), n);
+            return;
+        }
+
+        order.Reset();
+        for (uint32_t r = 0; r < runs.size(); r++) {
+            const SortRun& run = runs[r];
+            if (run.begin == run.end) continue;
+            RadixSortKeys(&keys[run.begin], &temp[run.begin], run.end - run.begin);
+            order.push_back({ keys[run.begin].key, r });
+        }
+        std::sort(order.begin(), order.end(), [](const SortKey& a, const SortKey& b) { return a.key < b.key || (a.key == b.key && a.index < b.index); });
+
+        // Walk the chunks far to near. A run that starts past the end of everything before it is copied across whole - only runs
+        // whose depths overlap (chunks side by side across the view) go through the merge
+        std::size_t out = 0;
+        for (std::size_t first = 0; first < order.size();) {
+            uint32_t groupLast = keys[runs[order[first].index].end - 1].key;
+            std::size_t last = first + 1;
+            for (; last < order.size() && order[last].key <= groupLast; last++) {
+                groupLast = std::max(groupLast, keys[runs[order[last].index].end - 1].key);
+            }
+
+            if (last == first + 1) {
+                const SortRun& run = runs[order[first].index];
+                std::copy(&keys[run.begin], &keys[run.begin] + (run.end - run.begin), &temp[out]);
+                out += run.end - run.begin;
+            } else {
+                out = MergeRuns(keys, first, last, out);
+            }
+            first = last;
+        }
+        std::swap(keys.items, temp.items);
+    }
+
+private:
+    // Min-heap ordered by key, then run index - runs are in gather order, so equal keys come out in the order the global sort would give
+    static bool HeapAfter(const SortKey& a, const SortKey& b) {
+        return a.key > b.key || (a.key == b.key && a.index > b.index);
+    }
+
+    // K-way merge of the sorted runs order[first, last) into temp from out. Returns where the output ends
+    std::size_t MergeRuns(ScratchBuffer<SortKey>& keys, std::size_t first, std::size_t last, std::size_t out) {
+        heap.Reset();
+        for (std::size_t o = first; o < last; o++) heap.push_back(order[o]);
+        std::make_heap(heap.begin(), heap.end(), HeapAfter);
+
+        while (heap.size() > 0) {
+            std::pop_heap(heap.begin(), heap.end(), HeapAfter);
+            SortRun& run = runs[heap.items.back().index];
+            temp[out++] = keys[run.begin++];
+
+            if (run.begin < run.end) {
+                heap.items.back().key = keys[run.begin].key;
+                std::push_heap(heap.begin(), heap.end(), HeapAfter);
+            } else {
+                heap.items.pop_back();
+            }
+        }
+        return out;
+    }
+};
+
+#endif
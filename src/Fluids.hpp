@@ -0,0 +1,328 @@
+// Fluids.hpp
+#ifndef FLUIDS_HPP
+#define FLUIDS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "WorldChunksBlocks.hpp"
+#include "JobSystem.hpp"
+
+// Water and lava as a cellular automaton. Each step works out the next state of every cell on the frontier (cells that changed last step,
+// or were edited, and their neighbours) purely from the previous state, then writes all the results at once - so the order cells are
+// visited in can't change the outcome, and the frontier can be split up by chunk and worked out in parallel. Still water costs nothing
+const int FLUID_TICK_INTERVAL = 5;        // Simulation ticks per fluid step - 12 steps a second
+const int LAVA_STEP_INTERVAL = 3;         // Lava only moves on every third step
+const int FLUID_PARALLEL_CELLS = 2048;    // Fronts smaller than this are stepped on the simulation thread alone
+const float FLUID_JOB_PRIORITY = -1.0e9f; // Ahead of every mesh build, since the simulation thread is waiting on it
+
+inline uint8_t FluidLevel(uint8_t fluid) { return fluid & 0x0F; }
+inline bool IsFluidSource(uint8_t fluid) { return (fluid & FLUID_SOURCE) != 0; }
+
+// Level lost per block of sideways flow - water runs 7 blocks from a source, lava 3
+inline int FluidDrop(BlockType type) { return type == BlockType::Lava ? 2 : 1; }
+
+// What a voxel holds, as far as fluids are concerned
+struct FluidCell {
+    BlockType type;
+    uint8_t fluid;
+
+    bool operator==(const FluidCell& other) const { return type == other.type && fluid == other.fluid; }
+    bool operator!=(const FluidCell& other) const { return !(*this == other); }
+};
+
+// Read-only view of the 3x3x3 chunks around one chunk - everything a step of that chunk's cells can reach, borders included. Gathered
+// straight from the chunk index, since World's one entry lookup cache can't be shared between threads
+struct FluidNeighbourhood {
+    int cx, cy, cz;
+    int chunkSize, chunkHeight;
+    int bottom; // Lowest y in the world - the floor below it holds fluid up like a solid block
+    const Chunk* chunks[27];
+
+    void Gather(const World& world, int centreX, int centreY, int centreZ) {
+        cx = centreX;
+        cy = centreY;
+        cz = centreZ;
+        chunkSize = world.chunkSize;
+        chunkHeight = world.chunkHeight;
+        bottom = world.lowestSection * world.chunkHeight;
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int index = world.chunkIndex.Find(PackCoords(cx + dx, cy + dy, cz + dz));
+                    chunks[((dy + 1) * 3 + (dz + 1)) * 3 + (dx + 1)] = index >= 0 ? &world.chunks[index] : nullptr;
+                }
+            }
+        }
+    }
+
+    // World position, which must be within a block of the centre chunk
+    FluidCell At(int x, int y, int z) const {
+        if (y < bottom) return { BlockType::Stone, 0 };
+        int ox = FloorDiv(x, chunkSize), oy = FloorDiv(y, chunkHeight), oz = FloorDiv(z, chunkSize);
+        const Chunk* chunk = chunks[((oy - cy + 1) * 3 + (oz - cz + 1)) * 3 + (ox - cx + 1)];
+        if (!chunk) return { BlockType::Air, 0 };
+        int i = chunk->VoxelIndex(x - ox * chunkSize, y - oy * chunkHeight, z - oz * chunkSize);
+        return { chunk->blocks.Get(i), chunk->FluidAt(i) };
+    }
+};
+
+// Highest level a cell would get of one kind of fluid from its neighbours - full from directly above, otherwise one drop less than the
+// best of the sides that are held up by something. Fluid still falling doesn't spread, so a waterfall stays a column
+// neighbours holds the cell's six neighbours in BlockFace order
+int FluidInflow(const FluidNeighbourhood& around, int x, int y, int z, const FluidCell* neighbours, BlockType kind) {
+    if (neighbours[FACE_TOP].type == kind) return FLUID_FULL;
+
+    int best = 0;
+    for (int f = 0; f < FACE_COUNT; f++) {
+        if (FACE_NORMALS[f][1] != 0) continue;
+        const FluidCell& side = neighbours[f];
+        if (side.type != kind) continue;
+        FluidCell under = around.At(x + FACE_NORMALS[f][0], y - 1, z + FACE_NORMALS[f][2]);
+        if (under.type == BlockType::Air || (under.type == kind && !IsFluidSource(under.fluid))) continue;
+        best = std::max(best, FluidLevel(side.fluid) - FluidDrop(kind));
+    }
+    return best;
+}
+
+// Next state of a cell, from the previous state of it and its neighbours
+FluidCell NextFluidState(const FluidNeighbourhood& around, int x, int y, int z) {
+    FluidCell cell = around.At(x, y, z);
+    if (cell.type != BlockType::Air && !IsFluid(cell.type)) return cell; // Solid blocks only hold fluid back
+
+    FluidCell neighbours[FACE_COUNT];
+    bool water = false, lava = false;
+    for (int f = 0; f < FACE_COUNT; f++) {
+        neighbours[f] = around.At(x + FACE_NORMALS[f][0], y + FACE_NORMALS[f][1], z + FACE_NORMALS[f][2]);
+        water |= neighbours[f].type == BlockType::Water;
+        lava |= neighbours[f].type == BlockType::Lava;
+    }
+
+    // Lava touching water sets into stone
+    if (cell.type == BlockType::Lava && water) return { BlockType::Stone, 0 };
+    if (IsFluidSource(cell.fluid)) return cell;
+
+    // Water wins where both could flow in - the lava beside it sets on the next lava step
+    int waterLevel = water ? FluidInflow(around, x, y, z, neighbours, BlockType::Water) : 0;
+    if (waterLevel > 0) return { BlockType::Water, static_cast<uint8_t>(waterLevel) };
+    int lavaLevel = lava ? FluidInflow(around, x, y, z, neighbours, BlockType::Lava) : 0;
+    if (lavaLevel > 0) return { BlockType::Lava, static_cast<uint8_t>(lavaLevel) };
+    return { BlockType::Air, 0 };
+}
+
+class FluidSimulation {
+public:
+    explicit FluidSimulation(World& world) : world(world) {}
+
+    // Forget the frontier - call once the world has been generated
+    void Reset() {
+        active.clear();
+        activeSlots.clear();
+        world.fluidUpdates.clear();
+        ticks = 0;
+        steps = 0;
+    }
+
+    // Once per simulation tick. Edits join the frontier straight away, and every FLUID_TICK_INTERVAL ticks the frontier takes a step.
+    // workers, if given, share the work of big steps
+    void Update(JobSystem* workers) {
+        for (const BlockKey& edit : world.fluidUpdates) ActivateAround(edit.x, edit.y, edit.z);
+        world.fluidUpdates.clear();
+
+        if (++ticks % FLUID_TICK_INTERVAL == 0) Step(workers);
+    }
+
+    // One step of the automaton over the current frontier
+    void Step(JobSystem* workers) {
+        // The frontier built up since the last step is worked through, while the next one builds up in its place
+        stepping.swap(active);
+        active.clear();
+        activeSlots.clear();
+        bool lavaMoves = steps++ % LAVA_STEP_INTERVAL == 0;
+
+        std::size_t cellCount = 0;
+        for (const ActiveChunk& chunk : stepping) cellCount += chunk.cells.size();
+        lastFrontier = cellCount;
+        cellsVisited += cellCount;
+
+        if (workers && stepping.size() > 1 && cellCount >= FLUID_PARALLEL_CELLS) {
+            ComputeParallel(*workers, lavaMoves);
+            parallelSteps++;
+        } else {
+            for (ActiveChunk& chunk : stepping) Compute(chunk, lavaMoves);
+        }
+
+        // Results go in chunk by chunk, in the order the chunks joined the frontier - the same whichever thread worked them out
+        bool changed = false;
+        for (ActiveChunk& chunk : stepping) changed |= Apply(chunk);
+        if (changed) world.version++;
+    }
+
+    bool Settled() const { return active.empty(); }
+    std::size_t FrontierSize() const { return lastFrontier; }
+
+    uint64_t cellsVisited = 0; // Frontier cells stepped so far, for benchmarking
+    uint64_t cellsChanged = 0; // Of those, the ones whose state changed
+    uint64_t parallelSteps = 0; // Steps whose front was big enough to share with the workers
+
+private:
+    // A voxel that changes this step
+    struct FluidChange {
+        uint16_t cell;
+        FluidCell state;
+    };
+
+    // Frontier cells of one chunk, which may not have been created yet - a missing chunk is air
+    struct ActiveChunk {
+        int cx, cy, cz;
+        std::vector<uint16_t> cells;   // Chunk-local voxel indices, in the order they were added
+        std::vector<uint64_t> marked;  // One bit per voxel, so a cell is only added once
+        std::vector<FluidChange> changes; // Filled in by Compute
+        std::vector<uint16_t> waiting;    // Lava cells held over to the next lava step
+    };
+
+    // Add a position to the next step's frontier
+    void Activate(int x, int y, int z) {
+        if (y < world.lowestSection * world.chunkHeight) return;
+        int cx = FloorDiv(x, world.chunkSize), cy = FloorDiv(y, world.chunkHeight), cz = FloorDiv(z, world.chunkSize);
+        uint64_t key = PackCoords(cx, cy, cz);
+
+        auto slot = activeSlots.find(key);
+        if (slot == activeSlots.end()) {
+            slot = activeSlots.emplace(key, active.size()).first;
+            active.emplace_back();
+            ActiveChunk& chunk = active.back();
+            chunk.cx = cx;
+            chunk.cy = cy;
+            chunk.cz = cz;
+            chunk.marked.assign((world.chunkSize * world.chunkSize * world.chunkHeight + 63) / 64, 0);
+        }
+
+        ActiveChunk& chunk = active[slot->second];
+        int i = ((y - cy * world.chunkHeight) * world.chunkSize + (z - cz * world.chunkSize)) * world.chunkSize + (x - cx * world.chunkSize);
+        uint64_t bit = 1ull << (i & 63);
+        if (chunk.marked[i >> 6] & bit) return;
+        chunk.marked[i >> 6] |= bit;
+        chunk.cells.push_back(static_cast<uint16_t>(i));
+    }
+
+    void ActivateAround(int x, int y, int z) {
+        Activate(x, y, z);
+        for (int f = 0; f < FACE_COUNT; f++) Activate(x + FACE_NORMALS[f][0], y + FACE_NORMALS[f][1], z + FACE_NORMALS[f][2]);
+    }
+
+    // Work out the next state of a chunk's frontier cells. Only reads the world, so chunks can be computed on any thread at once
+    void Compute(ActiveChunk& chunk, bool lavaMoves) const {
+        FluidNeighbourhood around;
+        around.Gather(world, chunk.cx, chunk.cy, chunk.cz);
+        chunk.changes.clear();
+        chunk.waiting.clear();
+
+        int ox = chunk.cx * world.chunkSize, oy = chunk.cy * world.chunkHeight, oz = chunk.cz * world.chunkSize;
+        for (uint16_t i : chunk.cells) {
+            int x = ox + i % world.chunkSize;
+            int z = oz + (i / world.chunkSize) % world.chunkSize;
+            int y = oy + i / (world.chunkSize * world.chunkSize);
+
+            FluidCell before = around.At(x, y, z);
+            FluidCell after = NextFluidState(around, x, y, z);
+            if (after == before) continue;
+            if (!lavaMoves && (before.type == BlockType::Lava || after.type == BlockType::Lava)) chunk.waiting.push_back(i);
+            else chunk.changes.push_back({ i, after });
+        }
+    }
+
+    // Split the chunks between the workers and this thread. Any worker that gets to its job after the work has run out just returns
+    void ComputeParallel(JobSystem& workers, bool lavaMoves) {
+        struct SharedStep {
+            std::atomic<std::size_t> next{0};
+            std::atomic<std::size_t> done{0};
+            std::size_t count = 0;
+            std::mutex mutex;
+            std::condition_variable finished;
+        };
+        auto shared = std::make_shared<SharedStep>();
+        shared->count = stepping.size();
+
+        auto work = [this, shared, lavaMoves]() {
+            for (std::size_t i = shared->next++; i < shared->count; i = shared->next++) {
+                Compute(stepping[i], lavaMoves);
+                if (++shared->done == shared->count) {
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    shared->finished.notify_one();
+                }
+            }
+        };
+
+        int helpers = std::min(workers.WorkerCount(), static_cast<int>(stepping.size()) - 1);
+        for (int i = 0; i < helpers; i++) workers.Submit(FLUID_JOB_PRIORITY, work);
+        work();
+
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        shared->finished.wait(lock, [&] { return shared->done.load() == shared->count; });
+    }
+
+    // Write a chunk's changes into the world and put them and their neighbours on the next frontier. Meshes are flagged once per chunk
+    // per step, for the chunk and whichever neighbours share a border with a changed cell. Returns true if anything changed
+    bool Apply(const ActiveChunk& stepped) {
+        int ox = stepped.cx * world.chunkSize, oy = stepped.cy * world.chunkHeight, oz = stepped.cz * world.chunkSize;
+        for (uint16_t i : stepped.waiting) {
+            Activate(ox + i % world.chunkSize, oy + i / (world.chunkSize * world.chunkSize), oz + (i / world.chunkSize) % world.chunkSize);
+        }
+        if (stepped.changes.empty()) return false;
+
+        uint32_t dirtyNeighbours = 0; // Bit ((dy + 1) * 3 + (dz + 1)) * 3 + (dx + 1) for each chunk whose mesh has to be rebuilt
+        for (const FluidChange& change : stepped.changes) {
+            int lx = change.cell % world.chunkSize;
+            int lz = (change.cell / world.chunkSize) % world.chunkSize;
+            int ly = change.cell / (world.chunkSize * world.chunkSize);
+            int x = ox + lx, y = oy + ly, z = oz + lz;
+
+            // Looked up each time, since creating a section moves the chunks
+            Chunk* chunk = world.GetChunkByCoords(stepped.cx, stepped.cy, stepped.cz);
+            if (!chunk) chunk = &world.CreateSection(stepped.cx, stepped.cy, stepped.cz); // Only air there to change, so this change adds fluid
+
+            BlockType type = chunk->blocks.Get(change.cell);
+            chunk->blocks.Set(change.cell, change.state.type);
+            chunk->SetFluid(change.cell, change.state.fluid);
+            cellsChanged++;
+            ActivateAround(x, y, z);
+
+            // A new level only matters to the next step - the mesh, the light and the blocks around only care about a new type
+            if (type == change.state.type) continue;
+            world.lightEdits.push_back({ x, y, z });
+            world.blockUpdates.push_back({ x, y, z });
+
+            int lowX = lx == 0 ? -1 : 0, highX = lx == world.chunkSize - 1 ? 1 : 0;
+            int lowY = ly == 0 ? -1 : 0, highY = ly == world.chunkHeight - 1 ? 1 : 0;
+            int lowZ = lz == 0 ? -1 : 0, highZ = lz == world.chunkSize - 1 ? 1 : 0;
+            for (int dy = lowY; dy <= highY; dy++) {
+                for (int dz = lowZ; dz <= highZ; dz++) {
+                    for (int dx = lowX; dx <= highX; dx++) dirtyNeighbours |= 1u << (((dy + 1) * 3 + (dz + 1)) * 3 + (dx + 1));
+                }
+            }
+        }
+
+        for (int bit = 0; bit < 27; bit++) {
+            if (!(dirtyNeighbours & (1u << bit))) continue;
+            Chunk* chunk = world.GetChunkByCoords(stepped.cx + bit % 3 - 1, stepped.cy + bit / 9 - 1, stepped.cz + bit / 3 % 3 - 1);
+            if (chunk) chunk->meshDirty = true;
+        }
+        return true;
+    }
+
+    World& world;
+    std::vector<ActiveChunk> active;   // Frontier for the next step, built up by edits and by the last step's changes
+    std::vector<ActiveChunk> stepping; // Frontier being stepped
+    std::unordered_map<uint64_t, std::size_t> activeSlots; // Packed chunk coordinates to an index into active
+    uint32_t ticks = 0;
+    uint32_t steps = 0;
+    std::size_t lastFrontier = 0;
+};
+
+#endif
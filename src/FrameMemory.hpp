@@ -0,0 +1,51 @@
+// FrameMemory.hpp
+#ifndef FRAME_MEMORY_HPP
+#define FRAME_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Persistent per-frame buffer - Reset() empties it but keeps the memory, and keeps enough reserved for the largest frame seen so far
+template <typename T>
+struct ScratchBuffer {
+    std::vector<T> items;
+    std::size_t highWaterMark = 0;
+
+    void Reset() {
+        if (items.size() > highWaterMark) highWaterMark = items.size();
+        items.clear();
+        if (items.capacity() < highWaterMark) items.reserve(highWaterMark);
+    }
+
+    std::size_t size() const { return items.size(); }
+    T& operator[](std::size_t i) { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+    void push_back(const T& item) { items.push_back(item); }
+    typename std::vector<T>::iterator begin() { return items.begin(); }
+    typename std::vector<T>::iterator end() { return items.end(); }
+    typename std::vector<T>::const_iterator begin() const { return items.begin(); }
+    typename std::vector<T>::const_iterator end() const { return items.end(); }
+};
+
+// Heap allocation counter - enabled with -DCOUNT_ALLOCATIONS (the native build turns it on). Counts per thread, so the
+// render thread's numbers are not muddied by the simulation thread
+thread_local std::size_t heapAllocationCount = 0;
+
+std::size_t GetHeapAllocationCount() { return heapAllocationCount; }
+
+#ifdef COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    heapAllocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+// ImageFile.hpp
+#ifndef IMAGE_FILE_HPP
+#define IMAGE_FILE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// 8 bit RGB image, rows top to bottom - what golden frames are stored and compared as
+struct RgbImage {
+    int width = 0, height = 0;
+    std::vector<uint8_t> pixels; // 3 bytes per pixel
+
+    void Resize(int w, int h) {
+        width = w;
+        height = h;
+        pixels.assign(static_cast<std::size_t>(w) * h * 3, 0);
+    }
+    uint8_t* Pixel(int x, int y) { return &pixels[(static_cast<std::size_t>(y) * width + x) * 3]; }
+    const uint8_t* Pixel(int x, int y) const { return &pixels[(static_cast<std::size_t>(y) * width + x) * 3]; }
+};
+
+// Binary PPM (P6) - no compression and no dependencies, so any tool can read the frames back
+bool WritePPM(const char* path, const RgbImage& image) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+    bool ok = fwrite(image.pixels.data(), 1, image.pixels.size(), file) == image.pixels.size();
+    return fclose(file) == 0 && ok;
+}
+
+// Reads the header numbers of a PPM, skipping whitespace and # comments
+bool ReadPPMNumber(FILE* file, int& value) {
+    int c = fgetc(file);
+    while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) c = fgetc(file);
+        }
+        c = fgetc(file);
+    }
+    if (c < '0' || c > '9') return false;
+    value = 0;
+    while (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        c = fgetc(file);
+    }
+    return true; // The single whitespace byte after the number has been read, as the format requires before the pixel data
+}
+
+bool ReadPPM(const char* path, RgbImage& image) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    int width = 0, height = 0, maxValue = 0;
+    bool ok = fgetc(file) == 'P' && fgetc(file) == '6' && ReadPPMNumber(file, width) && ReadPPMNumber(file, height) &&
+              ReadPPMNumber(file, maxValue) && maxValue == 255 && width > 0 && height > 0;
+    if (ok) {
+        image.Resize(width, height);
+        ok = fread(image.pixels.data(), 1, image.pixels.size(), file) == image.pixels.size();
+    }
+    fclose(file);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,123 @@
+// Input.hpp
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include <SDL2/SDL.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+using InputClock = std::chrono::steady_clock;
+
+// One mouse button press, with the motion that came before it in the same tick so the edit is aimed where the player was looking
+struct ButtonPress {
+    uint8_t button;            // SDL_BUTTON_LEFT or SDL_BUTTON_RIGHT
+    int mouseDx, mouseDy;      // Motion from the start of the tick up to the press
+    InputClock::time_point time;
+};
+
+// Everything the simulation gets for one tick
+struct TickInput {
+    bool keys[SDL_NUM_SCANCODES] = {false}; // Held at any point during the tick, so a quick tap is never missed
+    int mouseDx = 0, mouseDy = 0;           // All of the tick's motion
+    std::vector<ButtonPress> presses;       // In the order they happened
+
+    bool hasEvents = false;
+    InputClock::time_point oldestEvent;     // When the earliest event in the tick happened, for latency measurement
+};
+
+// Collects input events on the main thread, timestamped when SDL queued them, and hands them over whole once per simulation tick
+class InputQueue {
+public:
+    // Main thread
+    void Record(const SDL_Event& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        switch (event.type) {
+            case SDL_KEYDOWN:
+                held[event.key.keysym.scancode] = true;
+                pressed[event.key.keysym.scancode] = true;
+                break;
+            case SDL_KEYUP:
+                held[event.key.keysym.scancode] = false;
+                break;
+            case SDL_MOUSEMOTION:
+                mouseDx += event.motion.xrel;
+                mouseDy += event.motion.yrel;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                if (event.button.button != SDL_BUTTON_LEFT && event.button.button != SDL_BUTTON_RIGHT) return;
+                presses.push_back({ event.button.button, mouseDx, mouseDy, EventTime(event.common.timestamp) });
+                break;
+            default:
+                return;
+        }
+
+        if (!hasEvents) {
+            hasEvents = true;
+            oldestEvent = EventTime(event.common.timestamp);
+        }
+    }
+
+    // Simulation thread - everything since the last call. Reuses out's storage
+    void Take(TickInput& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < SDL_NUM_SCANCODES; i++) out.keys[i] = held[i] || pressed[i];
+        std::memset(pressed, 0, sizeof(pressed));
+
+        out.mouseDx = mouseDx;
+        out.mouseDy = mouseDy;
+        mouseDx = mouseDy = 0;
+
+        out.presses.clear();
+        out.presses.swap(presses);
+
+        out.hasEvents = hasEvents;
+        out.oldestEvent = oldestEvent;
+        hasEvents = false;
+    }
+
+private:
+    // SDL timestamps are milliseconds since SDL started - turn one into a point on the steady clock by its age
+    static InputClock::time_point EventTime(uint32_t timestamp) {
+        uint32_t age = SDL_GetTicks() - timestamp;
+        if (age > 1000) age = 0; // Timestamp missing or from another clock
+        return InputClock::now() - std::chrono::milliseconds(age);
+    }
+
+    std::mutex mutex;
+    bool held[SDL_NUM_SCANCODES] = {false};
+    bool pressed[SDL_NUM_SCANCODES] = {false}; // Went down since the last Take
+    int mouseDx = 0, mouseDy = 0;
+    std::vector<ButtonPress> presses;
+    bool hasEvents = false;
+    InputClock::time_point oldestEvent;
+};
+
+// Input-to-photon latency - time from the oldest event of a tick to the first presented frame showing that tick. Enabled with -DMEASURE_LATENCY
+struct LatencyStats {
+    uint32_t lastSequence = 0;
+    int samples = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+
+    void Record(uint32_t inputSequence, InputClock::time_point inputTime) {
+        if (inputSequence == lastSequence) return;
+        lastSequence = inputSequence;
+
+        double ms = std::chrono::duration<double, std::milli>(InputClock::now() - inputTime).count();
+        samples++;
+        totalMs += ms;
+        if (ms > maxMs) maxMs = ms;
+
+        if (samples == 120) {
+            printf("Input latency: %.1f ms average, %.1f ms max over the last %d inputs\n", totalMs / samples, maxMs, samples);
+            samples = 0;
+            totalMs = 0.0;
+            maxMs = 0.0;
+        }
+    }
+};
+
+#endif
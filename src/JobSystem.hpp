@@ -0,0 +1,124 @@
+// JobSystem.hpp
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads, each with its own priority queue. Workers run their own most urgent job first and steal from the others when they run dry
+class JobSystem {
+public:
+    explicit JobSystem(int workerCount) {
+        if (workerCount < 1) workerCount = 1;
+        for (int i = 0; i < workerCount; i++) queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+        for (int i = 0; i < workerCount; i++) threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queue a job - lower priority values run first, equal priorities run in submission order
+    void Submit(float priority, std::function<void()> work) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            pending++;
+        }
+
+        Job job;
+        job.priority = priority;
+        job.order = nextOrder++;
+        job.work = std::move(work);
+
+        WorkerQueue& queue = *queues[nextQueue++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.heap.push_back(std::move(job));
+            std::push_heap(queue.heap.begin(), queue.heap.end(), RunsAfter);
+        }
+        wake.notify_one();
+    }
+
+    int WorkerCount() const { return static_cast<int>(threads.size()); }
+
+private:
+    struct Job {
+        float priority;
+        uint64_t order;
+        std::function<void()> work;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::vector<Job> heap;
+    };
+
+    // Heap comparator - the most urgent job ends up at the front
+    static bool RunsAfter(const Job& a, const Job& b) {
+        return a.priority > b.priority || (a.priority == b.priority && a.order > b.order);
+    }
+
+    static bool TryPop(WorkerQueue& queue, Job& out) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.heap.empty()) return false;
+        std::pop_heap(queue.heap.begin(), queue.heap.end(), RunsAfter);
+        out = std::move(queue.heap.back());
+        queue.heap.pop_back();
+        return true;
+    }
+
+    // Own queue first, then steal from the others starting with the next worker along
+    bool TakeJob(int index, Job& out) {
+        int count = static_cast<int>(queues.size());
+        for (int i = 0; i < count; i++) {
+            if (TryPop(*queues[(index + i) % count], out)) return true;
+        }
+        return false;
+    }
+
+    void WorkerLoop(int index) {
+        while (true) {
+            Job job;
+            if (TakeJob(index, job)) {
+                {
+                    std::lock_guard<std::mutex> lock(wakeMutex);
+                    pending--;
+                }
+                job.work();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    int pending = 0;       // Jobs submitted but not yet taken, guarded by wakeMutex
+    bool stopping = false; // Guarded by wakeMutex
+
+    std::atomic<uint32_t> nextQueue{0};
+    std::atomic<uint64_t> nextOrder{0};
+};
+
+#endif
@@ -0,0 +1,360 @@
+// Lighting.hpp
+#ifndef LIGHTING_HPP
+#define LIGHTING_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "WorldChunksBlocks.hpp"
+
+// Light levels run from 0 (dark) to 15 (full). Each voxel stores sky light in the high nibble and block light in the low nibble
+const uint8_t MAX_LIGHT = 15;
+
+inline uint8_t PackLight(uint8_t sky, uint8_t block) { return static_cast<uint8_t>((sky << 4) | block); }
+inline uint8_t SkyLight(uint8_t packed) { return packed >> 4; }
+inline uint8_t BlockLight(uint8_t packed) { return packed & 0x0F; }
+
+// Recompute sky and block light for a box of chunks (inclusive chunk coordinates). Light flowing in from outside the box is taken from
+// what is already stored there, so only the box is touched. Chunks whose light changed are flagged for a mesh rebuild
+void RelightRegion(World& world, int cx0, int cy0, int cz0, int cx1, int cy1, int cz1) {
+    const int minX = cx0 * world.chunkSize;
+    const int minY = cy0 * world.chunkHeight;
+    const int minZ = cz0 * world.chunkSize;
+    const int sx = (cx1 - cx0 + 1) * world.chunkSize;
+    const int sy = (cy1 - cy0 + 1) * world.chunkHeight;
+    const int sz = (cz1 - cz0 + 1) * world.chunkSize;
+    const int cellCount = sx * sy * sz;
+
+    auto index = [&](int x, int y, int z) { return (y * sz + z) * sx + x; };
+
+    std::vector<uint8_t> opaque(cellCount, 0);
+    std::vector<uint8_t> sky(cellCount, 0);
+    std::vector<uint8_t> block(cellCount, 0);
+    std::vector<int> skyQueue;
+    std::vector<int> blockQueue;
+
+    // Opacity and light sources from the chunks in the box
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cz = cz0; cz <= cz1; cz++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                const Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+                if (!chunk) continue;
+
+                // Nothing to do for a chunk that is all air
+                if (chunk->blocks.IsUniform()) {
+                    const BlockInfo& info = GetBlockInfo(chunk->blocks.UniformType());
+                    if (!info.opaque && info.emission == 0) continue;
+                }
+
+                int bx = (cx - cx0) * world.chunkSize, by = (cy - cy0) * world.chunkHeight, bz = (cz - cz0) * world.chunkSize;
+                for (int y = 0; y < chunk->sizeY; y++) {
+                    for (int z = 0; z < chunk->sizeZ; z++) {
+                        for (int x = 0; x < chunk->sizeX; x++) {
+                            BlockType type = chunk->BlockAt(x, y, z);
+                            if (type == BlockType::Air) continue;
+                            int i = index(bx + x, by + y, bz + z);
+                            const BlockInfo& info = GetBlockInfo(type);
+                            opaque[i] = info.opaque;
+                            if (info.emission > 0) {
+                                block[i] = info.emission;
+                                blockQueue.push_back(i);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Direct sunlight falls straight down each column until it hits something opaque
+    for (int z = 0; z < sz; z++) {
+        for (int x = 0; x < sx; x++) {
+            if (SkyLight(world.GetLightAt(minX + x, minY + sy, minZ + z)) < MAX_LIGHT) continue;
+            for (int y = sy - 1; y >= 0; y--) {
+                int i = index(x, y, z);
+                if (opaque[i]) break;
+                sky[i] = MAX_LIGHT;
+                skyQueue.push_back(i);
+            }
+        }
+    }
+
+    // Light flowing in across the faces of the box
+    for (int y = 0; y < sy; y++) {
+        for (int z = 0; z < sz; z++) {
+            for (int x = 0; x < sx; x++) {
+                if (x > 0 && x < sx - 1 && y > 0 && y < sy - 1 && z > 0 && z < sz - 1) continue;
+                int i = index(x, y, z);
+                if (opaque[i]) continue;
+
+                for (int f = 0; f < FACE_COUNT; f++) {
+                    int nx = x + FACE_NORMALS[f][0];
+                    int ny = y + FACE_NORMALS[f][1];
+                    int nz = z + FACE_NORMALS[f][2];
+                    if (nx >= 0 && nx < sx && ny >= 0 && ny < sy && nz >= 0 && nz < sz) continue;
+
+                    uint8_t outside = world.GetLightAt(minX + nx, minY + ny, minZ + nz);
+                    if (SkyLight(outside) > sky[i] + 1) {
+                        sky[i] = SkyLight(outside) - 1;
+                        skyQueue.push_back(i);
+                    }
+                    if (BlockLight(outside) > block[i] + 1) {
+                        block[i] = BlockLight(outside) - 1;
+                        blockQueue.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+
+    // Flood fill each channel, losing one level per step
+    auto propagate = [&](std::vector<uint8_t>& channel, std::vector<int>& queue) {
+        for (std::size_t head = 0; head < queue.size(); head++) {
+            int i = queue[head];
+            uint8_t level = channel[i];
+            if (level <= 1) continue;
+
+            int x = i % sx;
+            int z = (i / sx) % sz;
+            int y = i / (sx * sz);
+            for (int f = 0; f < FACE_COUNT; f++) {
+                int nx = x + FACE_NORMALS[f][0];
+                int ny = y + FACE_NORMALS[f][1];
+                int nz = z + FACE_NORMALS[f][2];
+                if (nx < 0 || nx >= sx || ny < 0 || ny >= sy || nz < 0 || nz >= sz) continue;
+
+                int n = index(nx, ny, nz);
+                if (opaque[n] || channel[n] >= level - 1) continue;
+                channel[n] = level - 1;
+                queue.push_back(n);
+            }
+        }
+    };
+    propagate(sky, skyQueue);
+    propagate(block, blockQueue);
+
+    // Store the result back into the chunks
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cz = cz0; cz <= cz1; cz++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+                if (!chunk) continue;
+
+                int bx = cx * world.chunkSize - minX;
+                int by = cy * world.chunkHeight - minY;
+                int bz = cz * world.chunkSize - minZ;
+                bool changed = false;
+                for (int y = 0; y < chunk->sizeY; y++) {
+                    for (int z = 0; z < chunk->sizeZ; z++) {
+                        for (int x = 0; x < chunk->sizeX; x++) {
+                            int i = index(bx + x, by + y, bz + z);
+                            uint8_t packed = PackLight(sky[i], block[i]);
+                            uint8_t& stored = chunk->light[chunk->VoxelIndex(x, y, z)];
+                            if (stored != packed) {
+                                stored = packed;
+                                changed = true;
+                            }
+                        }
+                    }
+                }
+                if (changed) chunk->meshDirty = true;
+            }
+        }
+    }
+}
+
+// Light the whole world from scratch
+void RelightAll(World& world) {
+    if (world.chunks.empty()) return;
+
+    int cx0 = INT32_MAX, cy0 = INT32_MAX, cz0 = INT32_MAX;
+    int cx1 = INT32_MIN, cy1 = INT32_MIN, cz1 = INT32_MIN;
+    for (const Chunk& chunk : world.chunks) {
+        int cx = FloorDiv(static_cast<int>(chunk.offset.x), world.chunkSize);
+        int cy = FloorDiv(static_cast<int>(chunk.offset.y), world.chunkHeight);
+        int cz = FloorDiv(static_cast<int>(chunk.offset.z), world.chunkSize);
+        cx0 = std::min(cx0, cx); cy0 = std::min(cy0, cy); cz0 = std::min(cz0, cz);
+        cx1 = std::max(cx1, cx); cy1 = std::max(cy1, cy); cz1 = std::max(cz1, cz);
+    }
+    RelightRegion(world, cx0, cy0, cz0, cx1, cy1, cz1);
+}
+
+// Keeps light up to date as blocks change without recomputing whole regions. Edits are picked up from World::lightEdits and spread
+// with breadth-first add and remove queues per channel, crossing chunk borders freely. The queues persist between calls, so a big
+// change can be spread over several ticks within a time budget
+class LightEngine {
+public:
+    explicit LightEngine(World& world) : world(world), knownChunks(world.chunks.size()) {}
+
+    // Light the whole world from scratch, dropping any queued work
+    void Rebuild() {
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+            removeQueue[channel].clear();
+            addQueue[channel].clear();
+        }
+        world.lightEdits.clear();
+        RelightAll(world);
+        knownChunks = world.chunks.size();
+    }
+
+    // Pick up new edits and propagate until the queues are empty or the budget runs out. Returns true when light is settled
+    bool Update(float budgetMs) {
+        // Chunks created by edits start out as the open air they replace, which is what the light around them was worked out against -
+        // so their blocks are queued like edits and the usual remove and add passes correct everything, the sections below included
+        for (; knownChunks < world.chunks.size(); knownChunks++) {
+            const Chunk& chunk = world.chunks[knownChunks];
+            if (chunk.blocks.IsUniform() && chunk.blocks.UniformType() == BlockType::Air) continue;
+
+            int ox = static_cast<int>(chunk.offset.x), oy = static_cast<int>(chunk.offset.y), oz = static_cast<int>(chunk.offset.z);
+            for (int y = 0; y < chunk.sizeY; y++) {
+                for (int z = 0; z < chunk.sizeZ; z++) {
+                    for (int x = 0; x < chunk.sizeX; x++) {
+                        if (chunk.BlockAt(x, y, z) != BlockType::Air) BlockChanged(ox + x, oy + y, oz + z);
+                    }
+                }
+            }
+        }
+
+        for (const BlockKey& edit : world.lightEdits) BlockChanged(edit.x, edit.y, edit.z);
+        world.lightEdits.clear();
+
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(budgetMs));
+
+        // Removals first - they hand the cells they cannot darken over to the add queues
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+            if (!Propagate(removeQueue[channel], channel, true, deadline)) return false;
+        }
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+            if (!Propagate(addQueue[channel], channel, false, deadline)) return false;
+        }
+        return true;
+    }
+
+    bool Settled() const {
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+            if (!removeQueue[channel].empty() || !addQueue[channel].empty()) return false;
+        }
+        return world.lightEdits.empty() && knownChunks == world.chunks.size();
+    }
+
+    uint64_t cellsUpdated = 0; // Light values written so far, for benchmarking
+
+private:
+    enum { SKY = 0, BLOCK = 1, CHANNEL_COUNT = 2 };
+
+    struct LightNode {
+        int x, y, z;
+        uint8_t level; // Light the cell had before it was cleared (remove queues only)
+    };
+
+    // Find the chunk and chunk-local position for a world position
+    Chunk* Locate(int x, int y, int z, int& lx, int& ly, int& lz) {
+        int cx = FloorDiv(x, world.chunkSize), cy = FloorDiv(y, world.chunkHeight), cz = FloorDiv(z, world.chunkSize);
+        Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+        lx = x - cx * world.chunkSize;
+        ly = y - cy * world.chunkHeight;
+        lz = z - cz * world.chunkSize;
+        return chunk;
+    }
+
+    static uint8_t Channel(uint8_t packed, int channel) { return channel == SKY ? SkyLight(packed) : BlockLight(packed); }
+
+    uint8_t GetLevel(int x, int y, int z, int channel) {
+        int lx, ly, lz;
+        Chunk* chunk = Locate(x, y, z, lx, ly, lz);
+        return Channel(chunk ? chunk->light[chunk->VoxelIndex(lx, ly, lz)] : OPEN_AIR_LIGHT, channel);
+    }
+
+    // Returns false for positions outside every chunk - open air there is fixed
+    bool SetLevel(int x, int y, int z, int channel, uint8_t level) {
+        int lx, ly, lz;
+        Chunk* chunk = Locate(x, y, z, lx, ly, lz);
+        if (!chunk) return false;
+
+        uint8_t& packed = chunk->light[chunk->VoxelIndex(lx, ly, lz)];
+        packed = channel == SKY ? PackLight(level, BlockLight(packed)) : PackLight(SkyLight(packed), level);
+        cellsUpdated++;
+
+        // Faces in neighbouring chunks sample this cell too when it sits on the border
+        bool border = lx == 0 || ly == 0 || lz == 0 || lx == chunk->sizeX - 1 || ly == chunk->sizeY - 1 || lz == chunk->sizeZ - 1;
+        if (border) world.MarkDirtyAround(x, y, z);
+        else chunk->meshDirty = true;
+        return true;
+    }
+
+    // Queue the work for a block whose type changed at a position
+    void BlockChanged(int x, int y, int z) {
+        const BlockInfo& info = GetBlockInfo(world.GetBlockAt(x, y, z));
+
+        // Clear what the cell held and let the remove pass undo everything that spread from it. Opaque cells hold no light of their own
+        // beyond their emission - an open cell is refilled from its neighbours below
+        uint8_t sky = GetLevel(x, y, z, SKY);
+        uint8_t block = GetLevel(x, y, z, BLOCK);
+        if (info.opaque && sky > 0 && SetLevel(x, y, z, SKY, 0)) removeQueue[SKY].push_back({ x, y, z, sky });
+        if (block > 0 && (info.opaque || block != info.emission) && SetLevel(x, y, z, BLOCK, 0)) removeQueue[BLOCK].push_back({ x, y, z, block });
+
+        if (info.emission > 0 && SetLevel(x, y, z, BLOCK, info.emission)) addQueue[BLOCK].push_back({ x, y, z, 0 });
+
+        // An open cell lets the light around it back in
+        if (!info.opaque) {
+            for (int f = 0; f < FACE_COUNT; f++) {
+                LightNode node = { x + FACE_NORMALS[f][0], y + FACE_NORMALS[f][1], z + FACE_NORMALS[f][2], 0 };
+                addQueue[SKY].push_back(node);
+                addQueue[BLOCK].push_back(node);
+            }
+        }
+    }
+
+    // Work through one queue. Returns false if the deadline passed first (the rest of the queue is kept for next time)
+    template <typename TimePoint>
+    bool Propagate(std::deque<LightNode>& queue, int channel, bool removing, const TimePoint& deadline) {
+        int sinceCheck = 0;
+        while (!queue.empty()) {
+            if (++sinceCheck == 256) {
+                sinceCheck = 0;
+                if (std::chrono::steady_clock::now() >= deadline) return false;
+            }
+
+            LightNode node = queue.front();
+            queue.pop_front();
+            uint8_t level = removing ? node.level : GetLevel(node.x, node.y, node.z, channel);
+            if (level == 0) continue;
+
+            for (int f = 0; f < FACE_COUNT; f++) {
+                int nx = node.x + FACE_NORMALS[f][0];
+                int ny = node.y + FACE_NORMALS[f][1];
+                int nz = node.z + FACE_NORMALS[f][2];
+
+                // Full sunlight falls straight down without fading
+                bool sunbeam = channel == SKY && f == FACE_BOTTOM && level == MAX_LIGHT;
+                uint8_t neighbour = GetLevel(nx, ny, nz, channel);
+
+                if (removing) {
+                    if (neighbour == 0) continue;
+                    if (neighbour < level || (sunbeam && neighbour == MAX_LIGHT)) {
+                        // Lit from the cell being cleared - clear it too
+                        if (SetLevel(nx, ny, nz, channel, 0)) queue.push_back({ nx, ny, nz, neighbour });
+                    } else {
+                        // Lit from somewhere else - spread that light back in afterwards
+                        addQueue[channel].push_back({ nx, ny, nz, 0 });
+                    }
+                } else {
+                    uint8_t spread = sunbeam ? MAX_LIGHT : level - 1;
+                    if (neighbour >= spread || world.IsOpaqueBlockAt(nx, ny, nz)) continue;
+                    if (SetLevel(nx, ny, nz, channel, spread)) queue.push_back({ nx, ny, nz, 0 });
+                }
+            }
+        }
+        return true;
+    }
+
+    World& world;
+    std::size_t knownChunks;
+    std::deque<LightNode> removeQueue[CHANNEL_COUNT];
+    std::deque<LightNode> addQueue[CHANNEL_COUNT];
+};
+
+#endif
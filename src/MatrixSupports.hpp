@@ -48,12 +48,11 @@ struct Vec2 {
 struct Vertex {
     Vec3 pos;
     Vec2 tex;
+    float light = 1.0f; // Brightness from lighting and ambient occlusion, 0-1
 
     Vertex(const Vec3& p = Vec3(), const Vec2& t = Vec2()) : pos(p), tex(t) {}
 };
 
-bool CastRay(Vec3 origin, Vec3 direction, float maxDistance, Vec3& hitBlockPosition, Vec3& hitNormal);
-
 // 4x4 Matrix struct
 struct Mat4 { float m[4][4] = {0}; };
 
@@ -137,13 +136,4 @@ Mat4 MatrixQuickInverse(const Mat4& m) {
 // Triangle struct
 struct Triangle { Vertex v[3]; };
 
-// Face struct
-struct Face {
-    Triangle tris[2];
-    Vec3 normal;
-};
-
-// Mesh struct
-struct Mesh { std::vector<Face> faces; };
-
 #endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+// NetProtocol.hpp
+#ifndef NET_PROTOCOL_HPP
+#define NET_PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "WorldChunksBlocks.hpp"
+
+// Messages between a world server and its clients. Every field is little-endian with a fixed width, except run lengths in
+// section snapshots, which are varints
+const uint32_t NET_PROTOCOL_VERSION = 3;
+const uint16_t NET_DEFAULT_PORT = 27600;
+
+enum NetMessageType : uint8_t {
+    // Client to server
+    MSG_HELLO = 1,          // u32 protocol version
+    MSG_REQUEST_SECTION,    // i32 cx, cy, cz - answered with MSG_SECTION, and the section's column gets edit deltas from then on
+    MSG_RELEASE_COLUMN,     // i32 cx, cz - stop sending edits for a column
+    MSG_EDIT,               // BlockEdit - a request, only applied once it comes back in MSG_EDITS
+
+    // Server to client
+    MSG_WELCOME = 64,       // i32 world size in columns, i32 lowest and highest section
+    MSG_SECTION,            // i32 cx, cy, cz, u8 present, then the run-length encoded blocks if present
+    MSG_EDITS,              // u32 server tick, u16 count, BlockEdit each - every edit of the tick in the client's columns
+    MSG_STATS,              // u32 server tick, u32 clients, f32 average and max tick ms over the last second
+};
+
+// One block change, as sent both ways
+struct BlockEdit {
+    uint8_t added; // 1 for a placed block, 0 for a removed one
+    int32_t x, y, z;
+    uint8_t type;
+};
+
+// Appends fields to a message payload
+struct NetWriter {
+    std::vector<uint8_t>& out;
+
+    explicit NetWriter(std::vector<uint8_t>& buffer) : out(buffer) {}
+
+    void U8(uint8_t value) { out.push_back(value); }
+    void U16(uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+    }
+    void U32(uint32_t value) {
+        for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+    void I32(int32_t value) { U32(static_cast<uint32_t>(value)); }
+    void F32(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        U32(bits);
+    }
+    void VarUint(uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    void Edit(const BlockEdit& edit) {
+        U8(edit.added);
+        I32(edit.x);
+        I32(edit.y);
+        I32(edit.z);
+        U8(edit.type);
+    }
+};
+
+// Reads fields back out of a payload. Reading past the end gives zeroes and clears ok, so a message can be read through and checked once
+struct NetReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    NetReader(const uint8_t* data, uint32_t size) : p(data), end(data + size) {}
+
+    uint8_t U8() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+    uint16_t U16() {
+        uint16_t low = U8();
+        return static_cast<uint16_t>(low | U8() << 8);
+    }
+    uint32_t U32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(U8()) << (i * 8);
+        return value;
+    }
+    int32_t I32() { return static_cast<int32_t>(U32()); }
+    float F32() {
+        uint32_t bits = U32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    uint32_t VarUint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = U8();
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+    BlockEdit Edit() {
+        BlockEdit edit;
+        edit.added = U8();
+        edit.x = I32();
+        edit.y = I32();
+        edit.z = I32();
+        edit.type = U8();
+        return edit;
+    }
+};
+
+// A section's blocks as runs of one type in voxel order (x fastest, then z, then y), so the flat layers of terrain come down to a few
+// runs each and a uniform section to one
+void EncodeSectionBlocks(const Chunk& chunk, NetWriter& writer) {
+    int count = chunk.VoxelCount();
+    if (chunk.blocks.IsUniform()) {
+        writer.U8(static_cast<uint8_t>(chunk.blocks.UniformType()));
+        writer.VarUint(static_cast<uint32_t>(count));
+        return;
+    }
+
+    BlockType runType = chunk.blocks.Get(0);
+    uint32_t runLength = 0;
+    for (int i = 0; i < count; i++) {
+        BlockType type = chunk.blocks.Get(i);
+        if (type != runType) {
+            writer.U8(static_cast<uint8_t>(runType));
+            writer.VarUint(runLength);
+            runType = type;
+            runLength = 0;
+        }
+        runLength++;
+    }
+    writer.U8(static_cast<uint8_t>(runType));
+    writer.VarUint(runLength);
+}
+
+// Fills blocks from the runs - false if they don't add up to exactly count voxels of known types
+bool DecodeSectionBlocks(NetReader& reader, BlockStorage& blocks, int count) {
+    blocks.Reset(count, BlockType::Air);
+    int filled = 0;
+    while (filled < count) {
+        uint8_t type = reader.U8();
+        uint32_t length = reader.VarUint();
+        if (!reader.ok || type >= static_cast<uint8_t>(BlockType::Count) || length == 0 || length > static_cast<uint32_t>(count - filled)) return false;
+        if (static_cast<BlockType>(type) != BlockType::Air) {
+            for (uint32_t i = 0; i < length; i++) blocks.Set(filled + static_cast<int>(i), static_cast<BlockType>(type));
+        }
+        filled += static_cast<int>(length);
+    }
+    blocks.Compact();
+    return true;
+}
+
+// Payload of MSG_SECTION for the section at cx, cy, cz - a missing section is sent as not present, which means open air
+void WriteSectionMessage(const World& world, int cx, int cy, int cz, std::vector<uint8_t>& payload) {
+    NetWriter writer(payload);
+    writer.I32(cx);
+    writer.I32(cy);
+    writer.I32(cz);
+    const Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+    writer.U8(chunk ? 1 : 0);
+    if (chunk) EncodeSectionBlocks(*chunk, writer);
+}
+
+// Put a received section into a client's world. Light is left to the caller, which knows whether more sections are still to come
+bool ReceiveSection(World& world, NetReader& reader) {
+    int cx = reader.I32(), cy = reader.I32(), cz = reader.I32();
+    bool present = reader.U8() != 0;
+    if (!reader.ok) return false;
+    if (!present) return true;
+
+    Chunk* chunk = world.GetChunkByCoords(cx, cy, cz);
+    if (!chunk) chunk = &world.CreateSection(cx, cy, cz);
+    if (!DecodeSectionBlocks(reader, chunk->blocks, chunk->VoxelCount())) return false;
+
+    // Neighbours hid their faces against whatever was here before
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (Chunk* near = world.GetChunkByCoords(cx + dx, cy + dy, cz + dz)) near->meshDirty = true;
+            }
+        }
+    }
+    world.version++;
+    return true;
+}
+
+// Apply an edit the server confirmed. Returns true if it changed the world - false too for a block type this build doesn't know
+bool ApplyBlockEdit(World& world, const BlockEdit& edit) {
+    if (edit.added && (edit.type == static_cast<uint8_t>(BlockType::Air) || edit.type >= static_cast<uint8_t>(BlockType::Count))) return false;
+    uint32_t before = world.version;
+    if (edit.added) world.AddBlockAtPosition(edit.x, edit.y, edit.z, static_cast<BlockType>(edit.type));
+    else world.RemoveBlockAtPosition(edit.x, edit.y, edit.z);
+    return world.version != before;
+}
+
+#endif
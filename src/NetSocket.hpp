@@ -0,0 +1,217 @@
+// NetSocket.hpp
+#ifndef NET_SOCKET_HPP
+#define NET_SOCKET_HPP
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Largest message either side will accept - a section snapshot is a few kilobytes at worst
+const uint32_t NET_MAX_MESSAGE_SIZE = 1 << 20;
+// Received bytes held before the socket stops being read - enough for the biggest message, and past it TCP makes the sender wait
+const std::size_t NET_MAX_RECEIVE_BUFFER = NET_MAX_MESSAGE_SIZE + 4;
+// Unsent bytes a connection can build up before it's dropped as too far behind to catch up
+const std::size_t NET_MAX_PENDING = 8 << 20;
+
+// A non-blocking TCP connection carrying length-prefixed messages: a 4 byte little-endian length, then a type byte and the payload.
+// Sends are queued and written out by Flush, received bytes are buffered until a whole message has arrived
+class NetConnection {
+public:
+    NetConnection() = default;
+    explicit NetConnection(int socket) : fd(socket) { Configure(); }
+    NetConnection(const NetConnection&) = delete;
+    NetConnection& operator=(const NetConnection&) = delete;
+    ~NetConnection() { Close(); }
+
+    // Blocking connect, then the socket is switched to non-blocking
+    bool Connect(const char* host, uint16_t port) {
+        Close();
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        if (getaddrinfo(host, service, &hints, &found) != 0) return false;
+
+        for (addrinfo* addr = found; addr; addr = addr->ai_next) {
+            int s = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+            if (s < 0) continue;
+            if (connect(s, addr->ai_addr, addr->ai_addrlen) == 0) {
+                fd = s;
+                break;
+            }
+            close(s);
+        }
+        freeaddrinfo(found);
+        if (fd < 0) return false;
+        Configure();
+        return true;
+    }
+
+    bool IsOpen() const { return fd >= 0; }
+
+    void Close() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    // Queue one message. A peer that has let NET_MAX_PENDING bytes pile up is disconnected rather than queued for without limit
+    void Send(uint8_t type, const std::vector<uint8_t>& payload) {
+        if (fd < 0) return;
+        if (Pending() + payload.size() + 5 > NET_MAX_PENDING) {
+            overflowed = true;
+            Close();
+            return;
+        }
+        uint32_t length = static_cast<uint32_t>(payload.size() + 1);
+        uint8_t header[5] = { static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length >> 16), static_cast<uint8_t>(length >> 24), type };
+        outBuffer.insert(outBuffer.end(), header, header + 5);
+        outBuffer.insert(outBuffer.end(), payload.begin(), payload.end());
+    }
+
+    // Write as much of the queue as the socket takes. Returns false once the connection has failed
+    bool Flush() {
+        while (fd >= 0 && outStart < outBuffer.size()) {
+            ssize_t written = send(fd, &outBuffer[outStart], outBuffer.size() - outStart, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                Close();
+                return false;
+            }
+            outStart += static_cast<std::size_t>(written);
+            bytesSent += static_cast<uint64_t>(written);
+        }
+        if (outStart == outBuffer.size()) {
+            outBuffer.clear();
+            outStart = 0;
+        }
+        return fd >= 0;
+    }
+
+    // Bytes queued but not yet taken by the socket
+    std::size_t Pending() const { return outBuffer.size() - outStart; }
+
+    // True if the connection was closed for falling too far behind on sends
+    bool Overflowed() const { return overflowed; }
+
+    // Pull in what has arrived, up to NET_MAX_RECEIVE_BUFFER bytes not yet handed out. Returns false once the peer has closed or the connection failed
+    bool Receive() {
+        if (fd < 0) return false;
+        // Drop the messages already handed out before reading more
+        if (inStart > 0) {
+            inBuffer.erase(inBuffer.begin(), inBuffer.begin() + inStart);
+            inStart = 0;
+        }
+        while (inBuffer.size() < NET_MAX_RECEIVE_BUFFER) {
+            uint8_t chunk[16384];
+            ssize_t got = recv(fd, chunk, std::min(sizeof(chunk), NET_MAX_RECEIVE_BUFFER - inBuffer.size()), 0);
+            if (got > 0) {
+                inBuffer.insert(inBuffer.end(), chunk, chunk + got);
+                bytesReceived += static_cast<uint64_t>(got);
+                continue;
+            }
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (got < 0 && errno == EINTR) continue;
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    // The next whole message, if one has arrived. The payload points into the receive buffer and is only valid until the next Receive
+    bool NextMessage(uint8_t& type, const uint8_t*& payload, uint32_t& size) {
+        if (fd < 0 || inBuffer.size() - inStart < 4) return false;
+        const uint8_t* p = &inBuffer[inStart];
+        uint32_t length = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+        if (length == 0 || length > NET_MAX_MESSAGE_SIZE) {
+            Close(); // Garbage on the wire - nothing after this can be trusted
+            return false;
+        }
+        if (inBuffer.size() - inStart < 4 + length) return false;
+        type = p[4];
+        payload = p + 5;
+        size = length - 1;
+        inStart += 4 + length;
+        return true;
+    }
+
+    // Sleep until there is something to read or the timeout passes
+    bool WaitReadable(int timeoutMs) {
+        if (fd < 0) return false;
+        pollfd entry = { fd, POLLIN, 0 };
+        return poll(&entry, 1, timeoutMs) > 0;
+    }
+
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+
+private:
+    void Configure() {
+        if (fd < 0) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Edit batches are small and latency matters more than packet count
+    }
+
+    int fd = -1;
+    std::vector<uint8_t> inBuffer;
+    std::size_t inStart = 0;
+    std::vector<uint8_t> outBuffer;
+    std::size_t outStart = 0;
+    bool overflowed = false;
+};
+
+// Listening socket for the server - Accept never blocks
+class NetListener {
+public:
+    ~NetListener() { Close(); }
+
+    bool Listen(uint16_t port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return false;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+            Close();
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        return true;
+    }
+
+    // A newly connected socket, or -1 if nobody is waiting
+    int Accept() {
+        if (fd < 0) return -1;
+        return accept(fd, nullptr, nullptr);
+    }
+
+    void Close() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+private:
+    int fd = -1;
+};
+
+#endif
@@ -0,0 +1,83 @@
+// Raycast.hpp
+#ifndef RAYCAST_HPP
+#define RAYCAST_HPP
+
+#include <cmath>
+#include "WorldChunksBlocks.hpp"
+
+// Raycasting function using 3D DDA algorithm
+bool CastRay(const World& world, Vec3 origin, Vec3 direction, float maxDistance, Vec3& hitBlockPosition, Vec3& hitNormal) {
+    direction = direction.normalize();
+
+    float dx = direction.x;
+    float dy = direction.y;
+    float dz = direction.z;
+
+    int ix = int(floor(origin.x));
+    int iy = int(floor(origin.y));
+    int iz = int(floor(origin.z));
+
+    int stepX = (dx > 0) ? 1 : ((dx < 0) ? -1 : 0);
+    int stepY = (dy > 0) ? 1 : ((dy < 0) ? -1 : 0);
+    int stepZ = (dz > 0) ? 1 : ((dz < 0) ? -1 : 0);
+
+    float tMaxX, tMaxY, tMaxZ;
+    float tDeltaX = (dx != 0) ? fabs(1.0f / dx) : 1e30;
+    float tDeltaY = (dy != 0) ? fabs(1.0f / dy) : 1e30;
+    float tDeltaZ = (dz != 0) ? fabs(1.0f / dz) : 1e30;
+
+    if (dx != 0) {
+        float voxelBoundaryX = (dx > 0) ? (ix + 1) : ix;
+        tMaxX = (voxelBoundaryX - origin.x) / dx;
+    } else {
+        tMaxX = 1e30;
+    }
+
+    if (dy != 0) {
+        float voxelBoundaryY = (dy > 0) ? (iy + 1) : iy;
+        tMaxY = (voxelBoundaryY - origin.y) / dy;
+    } else {
+        tMaxY = 1e30;
+    }
+
+    if (dz != 0) {
+        float voxelBoundaryZ = (dz > 0) ? (iz + 1) : iz;
+        tMaxZ = (voxelBoundaryZ - origin.z) / dz;
+    } else {
+        tMaxZ = 1e30;
+    }
+
+    float t = 0;
+    int maxSteps = 1000;
+
+    for (int i = 0; i < maxSteps; i++) {
+        if (world.IsSolidBlockAt(ix, iy, iz)) {
+            hitBlockPosition = Vec3(float(ix), float(iy), float(iz));
+
+            if (tMaxX < tMaxY && tMaxX < tMaxZ)  hitNormal = Vec3(-stepX, 0, 0);
+            else if (tMaxY < tMaxZ)  hitNormal = Vec3(0, -stepY, 0);
+            else  hitNormal = Vec3(0, 0, -stepZ);
+            return true;
+        }
+
+        if (tMaxX < tMaxY && tMaxX < tMaxZ) {
+            ix += stepX;
+            t = tMaxX;
+            tMaxX += tDeltaX;
+        } else if (tMaxY < tMaxZ) {
+            iy += stepY;
+            t = tMaxY;
+            tMaxY += tDeltaY;
+        } else {
+            iz += stepZ;
+            t = tMaxZ;
+            tMaxZ += tDeltaZ;
+        }
+
+        if (t > maxDistance) break;
+    }
+
+    return false;
+}
+
+#endif
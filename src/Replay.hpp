@@ -0,0 +1,246 @@
+// Replay.hpp
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "ChunkMap.hpp"
+#include "Input.hpp"
+
+// Replay files are a header, one record per simulation tick, then an end record with the world hash to check playback against.
+// Everything is written little-endian with fixed widths
+const uint32_t REPLAY_MAGIC = 0x50524743; // "CGRP"
+const uint32_t REPLAY_VERSION = 3; // Bumped whenever world generation or block ticks change, since an older recording can no longer match
+const uint8_t REPLAY_TICK = 'T';
+const uint8_t REPLAY_END = 'E';
+
+// One block edit made during a tick - kept so playback can spot the exact tick it went out of step
+struct ReplayEdit {
+    uint8_t added; // 1 for a placed block, 0 for a removed one
+    int32_t x, y, z;
+    uint8_t type;
+
+    bool operator==(const ReplayEdit& other) const {
+        return added == other.added && x == other.x && y == other.y && z == other.z && type == other.type;
+    }
+    bool operator!=(const ReplayEdit& other) const { return !(*this == other); }
+};
+
+// Writes a recording as the simulation runs. Keys are stored as the scancodes that changed since the last tick, which is nearly always none
+class ReplayWriter {
+public:
+    ~ReplayWriter() { Close(); }
+
+    bool Open(const char* path, uint32_t seed) {
+        file = fopen(path, "wb");
+        if (!file) return false;
+        Write32(REPLAY_MAGIC);
+        Write32(REPLAY_VERSION);
+        Write32(seed);
+        std::memset(lastKeys, 0, sizeof(lastKeys));
+        ticks = 0;
+        return true;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+
+    void WriteTick(const TickInput& input, const std::vector<ReplayEdit>& edits) {
+        if (!file) return;
+        Write8(REPLAY_TICK);
+
+        changed.clear();
+        for (int i = 0; i < SDL_NUM_SCANCODES; i++) {
+            if (input.keys[i] != lastKeys[i]) changed.push_back(static_cast<uint16_t>(i));
+            lastKeys[i] = input.keys[i];
+        }
+        Write16(static_cast<uint16_t>(changed.size()));
+        for (uint16_t scancode : changed) Write16(scancode);
+
+        Write32(static_cast<uint32_t>(input.mouseDx));
+        Write32(static_cast<uint32_t>(input.mouseDy));
+
+        Write16(static_cast<uint16_t>(input.presses.size()));
+        for (const ButtonPress& press : input.presses) {
+            Write8(press.button);
+            Write32(static_cast<uint32_t>(press.mouseDx));
+            Write32(static_cast<uint32_t>(press.mouseDy));
+        }
+
+        Write16(static_cast<uint16_t>(edits.size()));
+        for (const ReplayEdit& edit : edits) {
+            Write8(edit.added);
+            Write32(static_cast<uint32_t>(edit.x));
+            Write32(static_cast<uint32_t>(edit.y));
+            Write32(static_cast<uint32_t>(edit.z));
+            Write8(edit.type);
+        }
+        ticks++;
+    }
+
+    // Ends the recording with the state the playback has to reproduce
+    void Finish(uint64_t worldHash) {
+        if (!file) return;
+        Write8(REPLAY_END);
+        Write32(ticks);
+        Write32(static_cast<uint32_t>(worldHash));
+        Write32(static_cast<uint32_t>(worldHash >> 32));
+        Close();
+    }
+
+    void Close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    uint32_t TickCount() const { return ticks; }
+
+private:
+    void Write8(uint8_t value) { fputc(value, file); }
+    void Write16(uint16_t value) {
+        uint8_t bytes[2] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) };
+        fwrite(bytes, 1, 2, file);
+    }
+    void Write32(uint32_t value) {
+        uint8_t bytes[4] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24) };
+        fwrite(bytes, 1, 4, file);
+    }
+
+    FILE* file = nullptr;
+    bool lastKeys[SDL_NUM_SCANCODES];
+    std::vector<uint16_t> changed;
+    uint32_t ticks = 0;
+};
+
+// Reads a recording back one tick at a time
+class ReplayReader {
+public:
+    uint32_t seed = 0;
+    uint32_t tickCount = 0;  // From the end record
+    uint64_t worldHash = 0;  // From the end record
+
+    ~ReplayReader() { Close(); }
+
+    bool Open(const char* path) {
+        file = fopen(path, "rb");
+        if (!file) return false;
+        uint32_t magic = 0, version = 0;
+        if (!Read32(magic) || !Read32(version) || !Read32(seed) || magic != REPLAY_MAGIC || version != REPLAY_VERSION) {
+            Close();
+            return false;
+        }
+        std::memset(keys, 0, sizeof(keys));
+        return true;
+    }
+
+    // Fills the next tick's input and the edits it made when it was recorded. Returns false at the end record (finished is then true) or on a truncated file
+    bool NextTick(TickInput& input, std::vector<ReplayEdit>& edits) {
+        uint8_t tag = 0;
+        if (!file || !Read8(tag)) return false;
+
+        if (tag == REPLAY_END) {
+            uint32_t low = 0, high = 0;
+            finished = Read32(tickCount) && Read32(low) && Read32(high);
+            worldHash = static_cast<uint64_t>(high) << 32 | low;
+            return false;
+        }
+        if (tag != REPLAY_TICK) return false;
+
+        uint16_t count = 0;
+        if (!Read16(count)) return false;
+        for (int i = 0; i < count; i++) {
+            uint16_t scancode = 0;
+            if (!Read16(scancode) || scancode >= SDL_NUM_SCANCODES) return false;
+            keys[scancode] = !keys[scancode];
+        }
+        std::copy(keys, keys + SDL_NUM_SCANCODES, input.keys);
+
+        uint32_t dx = 0, dy = 0;
+        if (!Read32(dx) || !Read32(dy)) return false;
+        input.mouseDx = static_cast<int32_t>(dx);
+        input.mouseDy = static_cast<int32_t>(dy);
+
+        input.presses.clear();
+        if (!Read16(count)) return false;
+        for (int i = 0; i < count; i++) {
+            ButtonPress press;
+            uint32_t pressDx = 0, pressDy = 0;
+            if (!Read8(press.button) || !Read32(pressDx) || !Read32(pressDy)) return false;
+            press.mouseDx = static_cast<int32_t>(pressDx);
+            press.mouseDy = static_cast<int32_t>(pressDy);
+            press.time = InputClock::now();
+            input.presses.push_back(press);
+        }
+        input.hasEvents = false;
+
+        edits.clear();
+        if (!Read16(count)) return false;
+        for (int i = 0; i < count; i++) {
+            ReplayEdit edit;
+            uint32_t x = 0, y = 0, z = 0;
+            if (!Read8(edit.added) || !Read32(x) || !Read32(y) || !Read32(z) || !Read8(edit.type)) return false;
+            edit.x = static_cast<int32_t>(x);
+            edit.y = static_cast<int32_t>(y);
+            edit.z = static_cast<int32_t>(z);
+            edits.push_back(edit);
+        }
+        return true;
+    }
+
+    bool Finished() const { return finished; }
+
+    void Close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+private:
+    bool Read8(uint8_t& value) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+        value = static_cast<uint8_t>(c);
+        return true;
+    }
+    bool Read16(uint16_t& value) {
+        uint8_t bytes[2];
+        if (fread(bytes, 1, 2, file) != 2) return false;
+        value = static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+        return true;
+    }
+    bool Read32(uint32_t& value) {
+        uint8_t bytes[4];
+        if (fread(bytes, 1, 4, file) != 4) return false;
+        value = static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+        return true;
+    }
+
+    FILE* file = nullptr;
+    bool keys[SDL_NUM_SCANCODES];
+    bool finished = false;
+};
+
+// Timing of one phase of playback over every tick
+struct ReplayTiming {
+    std::vector<double> samples; // Milliseconds
+
+    void Add(double ms) { samples.push_back(ms); }
+
+    void Print(const char* name) {
+        if (samples.empty()) return;
+        std::sort(samples.begin(), samples.end());
+        double total = 0.0;
+        for (double ms : samples) total += ms;
+        printf("  %-8s %8.3f ms average, %8.3f ms median, %8.3f ms 99th percentile, %8.3f ms max, %9.1f ms total\n", name,
+               total / samples.size(), samples[samples.size() / 2], samples[samples.size() * 99 / 100], samples.back(), total);
+    }
+};
+
+// Order-independent hash of a set of values - each one is mixed on its own and the results are summed, so hash map iteration order doesn't matter
+struct UnorderedHash {
+    uint64_t sum = 0;
+    void Add(uint64_t value) { sum += MixHash64(value + 0x9e3779b97f4a7c15ull); }
+};
+
+#endif
@@ -0,0 +1,81 @@
+// ResolutionScaler.hpp
+#ifndef RESOLUTION_SCALER_HPP
+#define RESOLUTION_SCALER_HPP
+
+#include <algorithm>
+
+// Limits and pacing for the internal render resolution. Scales apply to both axes, so 0.5 draws a quarter of the pixels
+struct ResolutionSettings {
+    float targetMs = 16.0f;      // Frame time to hold
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float step = 0.1f;           // Change per adjustment
+    float slowMargin = 1.1f;     // Drop once frames run this much over the target
+    int settleFrames = 30;       // Frames a frame time has to persist before the scale moves, and the wait after each move
+};
+
+// Picks the render scale from measured frame times. Frame times are smoothed, the scale drops only after they stay over the target
+// for a while and climbs only when the next step up should still fit, and every change is followed by a wait, so a single slow
+// frame - or the cost of the change itself - can't set it oscillating
+class ResolutionScaler {
+public:
+    ResolutionSettings settings;
+
+    void Configure(const ResolutionSettings& newSettings) {
+        settings = newSettings;
+        settings.minScale = std::min(std::max(settings.minScale, 0.1f), 1.0f);
+        settings.maxScale = std::min(std::max(settings.maxScale, settings.minScale), 1.0f); // Only ever scaled down from the window size
+        scale = settings.maxScale;
+        Restart();
+    }
+
+    float Scale() const { return scale; }
+
+    // Feed one rendered frame's time - returns true when the scale changed
+    bool Update(float frameMs) {
+        smoothedMs = smoothedMs <= 0.0f ? frameMs : smoothedMs + (frameMs - smoothedMs) * 0.1f;
+        if (cooldown > 0) {
+            cooldown--;
+            return false;
+        }
+
+        // Raster cost goes with the pixel count, so estimate the next step up from the area ratio
+        float up = std::min(scale + settings.step, settings.maxScale);
+        float upMs = smoothedMs * (up * up) / (scale * scale);
+
+        if (smoothedMs > settings.targetMs * settings.slowMargin && scale > settings.minScale + 0.001f) {
+            slowFrames++;
+            fastFrames = 0;
+        } else if (up > scale + 0.001f && upMs < settings.targetMs) {
+            fastFrames++;
+            slowFrames = 0;
+        } else {
+            slowFrames = fastFrames = 0;
+        }
+
+        float next = scale;
+        if (slowFrames >= settings.settleFrames) next = std::max(scale - settings.step, settings.minScale);
+        else if (fastFrames >= settings.settleFrames * 2) next = up; // Slower to climb than to drop
+        if (next == scale) return false;
+
+        scale = next;
+        Restart();
+        return true;
+    }
+
+private:
+    // Measure the new resolution from scratch
+    void Restart() {
+        smoothedMs = 0.0f;
+        slowFrames = fastFrames = 0;
+        cooldown = settings.settleFrames;
+    }
+
+    float scale = 1.0f;
+    float smoothedMs = 0.0f;
+    int slowFrames = 0;
+    int fastFrames = 0;
+    int cooldown = 0;
+};
+
+#endif
@@ -0,0 +1,135 @@
+// TextureAtlas.hpp
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Texture Atlas Settings
+const int TEX_SIZE = 16;        // Tile size in the source image
+const int ATLAS_PADDING = 1;    // Border of repeated edge texels around every tile and mip, so nearest sampling never picks up a neighbour
+const int ATLAS_MIP_LEVELS = 5; // 16, 8, 4, 2 and 1 texels across
+
+// One mip of one tile in normalised texture coordinates - the inside of the padding
+struct AtlasRect {
+    float u0, v0, u1, v1;
+};
+
+// The source atlas decoded once and laid out again for drawing. Each tile gets one strip holding its whole padded mip chain side by side,
+// and the strips are stacked, so all the texels of a tile sit in one contiguous block of rows
+struct TextureAtlas {
+    SDL_Texture* texture = nullptr;
+    int tileCount = 0;
+    std::vector<AtlasRect> rects; // tile * ATLAS_MIP_LEVELS + level
+
+    bool Load(SDL_Renderer* renderer, const char* path) {
+        SDL_Surface* loaded = IMG_Load(path);
+        if (!loaded) return false;
+        SDL_Surface* source = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+        if (!source) return false;
+
+        int columns = source->w / TEX_SIZE;
+        tileCount = columns * (source->h / TEX_SIZE);
+
+        int stripWidth = 0;
+        for (int level = 0; level < ATLAS_MIP_LEVELS; level++) stripWidth += (TEX_SIZE >> level) + ATLAS_PADDING * 2;
+        int stripHeight = TEX_SIZE + ATLAS_PADDING * 2;
+        int width = stripWidth;
+        int height = stripHeight * tileCount;
+
+        std::vector<uint8_t> pixels(width * height * 4, 0);
+        rects.resize(tileCount * ATLAS_MIP_LEVELS);
+
+        SDL_LockSurface(source);
+        for (int tile = 0; tile < tileCount; tile++) {
+            // Level 0 straight from the source image
+            std::vector<uint8_t> mip(TEX_SIZE * TEX_SIZE * 4);
+            int srcX = (tile % columns) * TEX_SIZE;
+            int srcY = (tile / columns) * TEX_SIZE;
+            for (int y = 0; y < TEX_SIZE; y++) {
+                const uint8_t* row = static_cast<const uint8_t*>(source->pixels) + (srcY + y) * source->pitch + srcX * 4;
+                std::memcpy(&mip[y * TEX_SIZE * 4], row, TEX_SIZE * 4);
+            }
+
+            int stripX = 0;
+            int stripY = tile * stripHeight;
+            for (int level = 0; level < ATLAS_MIP_LEVELS; level++) {
+                int size = TEX_SIZE >> level;
+
+                // Copy the mip in with its edge texels repeated out into the padding
+                for (int y = -ATLAS_PADDING; y < size + ATLAS_PADDING; y++) {
+                    for (int x = -ATLAS_PADDING; x < size + ATLAS_PADDING; x++) {
+                        int sx = std::min(std::max(x, 0), size - 1);
+                        int sy = std::min(std::max(y, 0), size - 1);
+                        uint8_t* dst = &pixels[((stripY + ATLAS_PADDING + y) * width + stripX + ATLAS_PADDING + x) * 4];
+                        std::memcpy(dst, &mip[(sy * size + sx) * 4], 4);
+                    }
+                }
+
+                AtlasRect& rect = rects[tile * ATLAS_MIP_LEVELS + level];
+                rect.u0 = static_cast<float>(stripX + ATLAS_PADDING) / width;
+                rect.v0 = static_cast<float>(stripY + ATLAS_PADDING) / height;
+                rect.u1 = static_cast<float>(stripX + ATLAS_PADDING + size) / width;
+                rect.v1 = static_cast<float>(stripY + ATLAS_PADDING + size) / height;
+                stripX += size + ATLAS_PADDING * 2;
+
+                // Box filter down to the next level
+                if (size > 1) {
+                    int half = size / 2;
+                    std::vector<uint8_t> next(half * half * 4);
+                    for (int y = 0; y < half; y++) {
+                        for (int x = 0; x < half; x++) {
+                            for (int c = 0; c < 4; c++) {
+                                int sum = mip[((y * 2) * size + x * 2) * 4 + c] + mip[((y * 2) * size + x * 2 + 1) * 4 + c] +
+                                          mip[((y * 2 + 1) * size + x * 2) * 4 + c] + mip[((y * 2 + 1) * size + x * 2 + 1) * 4 + c];
+                                next[(y * half + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                            }
+                        }
+                    }
+                    mip.swap(next);
+                }
+            }
+        }
+        SDL_UnlockSurface(source);
+        SDL_FreeSurface(source);
+
+        SDL_Surface* laidOut = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!laidOut) return false;
+        SDL_LockSurface(laidOut);
+        for (int y = 0; y < height; y++) {
+            std::memcpy(static_cast<uint8_t*>(laidOut->pixels) + y * laidOut->pitch, &pixels[y * width * 4], width * 4);
+        }
+        SDL_UnlockSurface(laidOut);
+
+        texture = SDL_CreateTextureFromSurface(renderer, laidOut);
+        SDL_FreeSurface(laidOut);
+        if (!texture) return false;
+
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest);
+        return true;
+    }
+
+    const AtlasRect& Rect(uint8_t tile, int level) const { return rects[tile * ATLAS_MIP_LEVELS + level]; }
+
+    // Mip for a triangle covering texelArea texels of the full size tile and pixelArea pixels on screen - one level per halving of texels per pixel
+    static int SelectMip(float texelArea, float pixelArea) {
+        if (texelArea <= pixelArea) return 0;
+        if (pixelArea <= 0.0f) return ATLAS_MIP_LEVELS - 1;
+        int level = static_cast<int>(0.5f * log2f(texelArea / pixelArea));
+        return std::min(level, ATLAS_MIP_LEVELS - 1);
+    }
+
+    void Destroy() {
+        if (texture) SDL_DestroyTexture(texture);
+        texture = nullptr;
+    }
+};
+
+#endif
@@ -2,6 +2,26 @@
 #ifndef WORLD_HPP
 #define WORLD_HPP
 
+#include <memory>
+#include "BlockRegistry.hpp"
+#include "BlockStorage.hpp"
+#include "ChunkMap.hpp"
+
+struct ChunkMesh;
+
+// Chunks are cubic sections of this many blocks along each axis
+const int SECTION_SIZE = 16;
+
+// Terrain this low is topped with sand rather than grass
+const int SHORE_HEIGHT = 2;
+
+// Fluid level of a voxel, kept in Chunk::fluid - 1 to FLUID_FULL, with FLUID_SOURCE set on fluid that never drains (see Fluids.hpp)
+const uint8_t FLUID_FULL = 8;
+const uint8_t FLUID_SOURCE = 0x80;
+
+// Packed light of a voxel outside every chunk - full sky light in the high nibble, no block light (see Lighting.hpp)
+const uint8_t OPEN_AIR_LIGHT = 0xF0;
+
 // Gen seed based on the current time
 unsigned int GenerateSeed() {
     using namespace std::chrono;
@@ -12,42 +32,54 @@ unsigned int GenerateSeed() {
     );
 }
 
-// Block Types
-enum class BlockType {
-    Air = 0,
-    Stone,
-    Dirt,
-    OakWood,
-    Grass,
-    GrassSide
-};
-
 struct BlockKey {
     int x, y, z;
     bool operator==(const BlockKey& other) const { return x == other.x && y == other.y && z == other.z; }
 };
 
-// Hash function for BlockKey
+// Integer division rounding towards negative infinity, so negative coordinates land in the right chunk
+inline int FloorDiv(int a, int b) { return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+
+// Hash function for BlockKey - packed coordinates through a strong mixer, the old shifted XOR collided badly on small grids
 struct BlockKeyHash {
     std::size_t operator()(const BlockKey& k) const {
-        return ((std::hash<int>()(k.x) ^
-                (std::hash<int>()(k.y) << 1)) >> 1) ^
-                (std::hash<int>()(k.z) << 1);
+        return static_cast<std::size_t>(MixHash64(PackCoords(k.x, k.y, k.z)));
     }
 };
 
-// Block struct with BlockType
-struct Block {
-    Vec3 position;
-    BlockType type;
-    Block(Vec3 pos = Vec3(), BlockType t = BlockType::Stone) : position(pos), type(t) {}
-};
-
 // Chunk Struct
 struct Chunk {
     int sizeX, sizeY, sizeZ;
     Vec3 offset;
-    std::vector<Block> blocks;
+    BlockStorage blocks; // Type of every voxel, indexed by VoxelIndex
+
+    // Packed sky/block light for every voxel in the chunk, filled in by Lighting.hpp
+    std::vector<uint8_t> light;
+
+    // Fluid level of every voxel, indexed by VoxelIndex - empty until the chunk first holds fluid
+    std::vector<uint8_t> fluid;
+
+    // Render mesh handle - rebuilt on a worker thread when meshDirty is set (see ChunkMesh.hpp)
+    std::shared_ptr<const ChunkMesh> mesh;
+    bool meshDirty = true;
+    uint32_t meshRequested = 0; // Sequence number of the newest mesh build submitted
+    uint32_t meshApplied = 0;   // Sequence number of the build currently in mesh
+
+    // Chunk-local coordinates to an index into blocks and light
+    int VoxelIndex(int x, int y, int z) const { return (y * sizeZ + z) * sizeX + x; }
+    int VoxelCount() const { return sizeX * sizeY * sizeZ; }
+
+    BlockType BlockAt(int x, int y, int z) const { return blocks.Get(VoxelIndex(x, y, z)); }
+
+    uint8_t FluidAt(int i) const { return fluid.empty() ? 0 : fluid[i]; }
+
+    void SetFluid(int i, uint8_t level) {
+        if (fluid.empty()) {
+            if (level == 0) return;
+            fluid.assign(VoxelCount(), 0);
+        }
+        fluid[i] = level;
+    }
 
     // Create flat chunk of stone blocks - this is mainly used for testing
     void GenerateFlatTerrain(int sizeX, int sizeZ, Vec3 offset, int sizeY) {
@@ -56,34 +88,43 @@ struct Chunk {
         this->sizeY = sizeY;
         this->offset = offset;
 
+        blocks.Reset(VoxelCount(), BlockType::Air);
         for (int x = 0; x < sizeX; x++) {
-            for (int z = 0; z < sizeZ; z++) {
-                Block block;
-                block.position = {
-                    static_cast<float>(x) + offset.x,
-                    0.0f + offset.y,
-                    static_cast<float>(z) + offset.z
-                };
-                block.type = BlockType::Stone;
-                blocks.push_back(block);
-            }
+            for (int z = 0; z < sizeZ; z++) blocks.Set(VoxelIndex(x, 0, z), BlockType::Stone);
         }
     }
 };
 
 // World Struct
 struct World {
-    std::vector<Chunk> chunks;
+    std::vector<Chunk> chunks; // Cubic sections, stacked vertically - a section only exists once something has been put in it
     int worldSize;
     int chunkSize;
     int chunkHeight;
+    int lowestSection = 0, highestSection = -1; // Vertical range of the sections, in section coordinates
+    unsigned int seed; // Terrain seed, kept so a recording can regenerate the same world
     PerlinNoise perlin;
-    std::unordered_map<BlockKey, Block, BlockKeyHash> blockMap;
-    World() : perlin(GenerateSeed()) {}
+    uint32_t version = 0; // Bumped on every edit so cached render data knows to rebuild
+    std::vector<BlockKey> lightEdits; // Positions edited since the light engine last looked (see Lighting.hpp)
+    std::vector<BlockKey> blockUpdates; // Positions edited since the block ticker last looked (see BlockTicks.hpp)
+    std::vector<BlockKey> fluidUpdates; // Positions edited since the fluid simulation last looked (see Fluids.hpp)
+
+    // Chunk lookup by chunk coordinates, plus a one entry cache since queries tend to hit the same chunk repeatedly (simulation thread only)
+    ChunkMap chunkIndex;
+    mutable uint64_t lastChunkKey = 0;
+    mutable int lastChunkIndex = -1;
+
+    World() : seed(GenerateSeed()), perlin(seed) {}
+
+    // Pick the terrain seed - must be called before the world is generated
+    void SetSeed(unsigned int newSeed) {
+        seed = newSeed;
+        perlin = PerlinNoise(newSeed);
+    }
 
     void Initialise() {
-        chunkSize = 12;
-        chunkHeight = 32;
+        chunkSize = SECTION_SIZE;
+        chunkHeight = SECTION_SIZE;
         worldSize = 3;
     }
 
@@ -98,40 +139,22 @@ struct World {
                     static_cast<float>(cz * chunkSize)
                 };
                 chunk.GenerateFlatTerrain(chunkSize, chunkSize, chunkOffset, chunkHeight);
-                chunks.push_back(chunk);
-
-                // Populate blockMap
-                for (const Block& block : chunk.blocks) {
-                    BlockKey key = {static_cast<int>(block.position.x),
-                                    static_cast<int>(block.position.y),
-                                    static_cast<int>(block.position.z)};
-                    blockMap[key] = block;
-                }
+                AddChunk(chunk);
             }
         }
     }
 
-    // Generate Perlin World
+    // Generate Perlin World - only the sections that hold blocks are created, the sky above the terrain costs nothing
     void GeneratePerlinWorld() {
+        std::vector<int> heights(chunkSize * chunkSize);
         for (int cx = 0; cx < worldSize; cx++) {
             for (int cz = 0; cz < worldSize; cz++) {
-                Chunk chunk;
-                Vec3 chunkOffset = {
-                    static_cast<float>(cx * chunkSize),
-                    0.0f,
-                    static_cast<float>(cz * chunkSize)
-                };
-                chunk.sizeX = chunkSize;
-                chunk.sizeZ = chunkSize;
-                chunk.sizeY = chunkHeight;
-                chunk.offset = chunkOffset;
-
-                // Generate terrain using Perlin noise
+                int top = 0;
                 for (int x = 0; x < chunkSize; x++) {
                     for (int z = 0; z < chunkSize; z++) {
                         // World coordinates
-                        float worldX = chunkOffset.x + static_cast<float>(x);
-                        float worldZ = chunkOffset.z + static_cast<float>(z);
+                        float worldX = static_cast<float>(cx * chunkSize + x);
+                        float worldZ = static_cast<float>(cz * chunkSize + z);
 
                         // Parameters for Perlin noise
                         double frequency = 0.15;
@@ -140,121 +163,197 @@ struct World {
                         // Calculate Perlin value
                         double noiseValue = perlin.noise(worldX * frequency, worldZ * frequency, 0.0);
                         int height = static_cast<int>(noiseValue * amplitude) + 1;
+                        heights[z * chunkSize + x] = height;
+                        top = std::max(top, height);
+                    }
+                }
+
+                for (int cy = 0; cy * chunkHeight < top; cy++) {
+                    Chunk chunk;
+                    chunk.sizeX = chunkSize;
+                    chunk.sizeZ = chunkSize;
+                    chunk.sizeY = chunkHeight;
+                    chunk.offset = {
+                        static_cast<float>(cx * chunkSize),
+                        static_cast<float>(cy * chunkHeight),
+                        static_cast<float>(cz * chunkSize)
+                    };
+                    chunk.blocks.Reset(chunk.VoxelCount(), BlockType::Air);
 
-                        // Populate blocks up to calculated height
-                        for (int y = 0; y < height && y < chunkHeight; y++) {
-                            Block block;
-                            block.position = {
-                                static_cast<float>(x) + chunkOffset.x,
-                                static_cast<float>(y) + chunkOffset.y,
-                                static_cast<float>(z) + chunkOffset.z
-                            };
-
-                            // Assign Block Types to World
-                            // - TOP LAYER is Grass
-                            // - 3 LAYERS BELOW TOP are Dirt
-                            // - REST are Stone
-                            if (y == height - 1) block.type = BlockType::Grass;
-                            else if (y >= height - 3)  block.type = BlockType::Dirt;
-                            else  block.type = BlockType::Stone;
-
-                            chunk.blocks.push_back(block);
-
-                            // Add to blockMap
-                            BlockKey key = {static_cast<int>(block.position.x),
-                                           static_cast<int>(block.position.y),
-                                           static_cast<int>(block.position.z)};
-                            blockMap[key] = block;
+                    // Populate blocks up to calculated height
+                    for (int x = 0; x < chunkSize; x++) {
+                        for (int z = 0; z < chunkSize; z++) {
+                            int height = heights[z * chunkSize + x];
+                            for (int y = cy * chunkHeight; y < height && y < (cy + 1) * chunkHeight; y++) {
+                                // Assign Block Types to World
+                                // - TOP LAYER is Grass
+                                // - 3 LAYERS BELOW TOP are Dirt
+                                // - REST are Stone
+                                // - Low ground by the pits is Sand down to where the Dirt would end
+                                BlockType type;
+                                if (height <= SHORE_HEIGHT && y >= height - 3) type = BlockType::Sand;
+                                else if (y == height - 1) type = BlockType::Grass;
+                                else if (y >= height - 3)  type = BlockType::Dirt;
+                                else  type = BlockType::Stone;
+
+                                chunk.blocks.Set(chunk.VoxelIndex(x, y - cy * chunkHeight, z), type);
+                            }
                         }
                     }
+                    chunk.blocks.Compact();
+                    AddChunk(chunk);
                 }
-                chunks.push_back(chunk);
             }
         }
     }
 
+    // Add a chunk (its offset must sit on the chunk grid) and index it by chunk coordinates
+    Chunk& AddChunk(const Chunk& chunk) {
+        int cx = FloorDiv(static_cast<int>(chunk.offset.x), chunkSize);
+        int cy = FloorDiv(static_cast<int>(chunk.offset.y), chunkHeight);
+        int cz = FloorDiv(static_cast<int>(chunk.offset.z), chunkSize);
+        lowestSection = chunks.empty() ? cy : std::min(lowestSection, cy);
+        highestSection = chunks.empty() ? cy : std::max(highestSection, cy);
+        chunks.push_back(chunk);
+        chunks.back().light.assign(chunk.sizeX * chunk.sizeY * chunk.sizeZ, OPEN_AIR_LIGHT);
+        chunkIndex.Insert(PackCoords(cx, cy, cz), static_cast<int>(chunks.size() - 1));
+        return chunks.back();
+    }
+
+    // Add an empty section, plus any missing ones between it and the rest of its column. Columns are kept unbroken so that a missing
+    // section always means open sky - otherwise the space under an overhang would be lit as if nothing were above it
+    Chunk& CreateSection(int cx, int cy, int cz) {
+        int below = cy - 1;
+        while (below >= lowestSection && !GetChunkByCoords(cx, below, cz)) below--;
+        int above = cy + 1;
+        while (above <= highestSection && !GetChunkByCoords(cx, above, cz)) above++;
+
+        int first = below >= lowestSection ? below + 1 : std::min(lowestSection, cy); // An empty column is filled down to the bottom of the world
+        int last = above <= highestSection ? above - 1 : cy;
+        for (int y = first; y <= last; y++) {
+            Chunk section;
+            section.sizeX = chunkSize;
+            section.sizeY = chunkHeight;
+            section.sizeZ = chunkSize;
+            section.offset = {
+                static_cast<float>(cx * chunkSize),
+                static_cast<float>(y * chunkHeight),
+                static_cast<float>(cz * chunkSize)
+            };
+            section.blocks.Reset(section.VoxelCount(), BlockType::Air);
+            AddChunk(section);
+        }
+        return *GetChunkByCoords(cx, cy, cz);
+    }
+
+    // Index into chunks for the given chunk coordinates, or -1
+    int FindChunkIndex(int cx, int cy, int cz) const {
+        uint64_t key = PackCoords(cx, cy, cz);
+        if (lastChunkIndex >= 0 && key == lastChunkKey) return lastChunkIndex;
+
+        int index = chunkIndex.Find(key);
+        if (index >= 0) {
+            lastChunkKey = key;
+            lastChunkIndex = index;
+        }
+        return index;
+    }
+
+    Chunk* GetChunkByCoords(int cx, int cy, int cz) {
+        int index = FindChunkIndex(cx, cy, cz);
+        return index >= 0 ? &chunks[index] : nullptr;
+    }
+
+    const Chunk* GetChunkByCoords(int cx, int cy, int cz) const {
+        int index = FindChunkIndex(cx, cy, cz);
+        return index >= 0 ? &chunks[index] : nullptr;
+    }
+
     // Get chunk at a given world pos
     Chunk* GetChunkAt(int x, int y, int z) {
-        for (Chunk& chunk : chunks) {
-            if (x >= static_cast<int>(chunk.offset.x) && x < static_cast<int>(chunk.offset.x + chunk.sizeX) &&
-                y >= static_cast<int>(chunk.offset.y) && y < static_cast<int>(chunk.offset.y + chunk.sizeY) &&
-                z >= static_cast<int>(chunk.offset.z) && z < static_cast<int>(chunk.offset.z + chunk.sizeZ)) {
-                return &chunk;
-            }
-        }
-        return nullptr;
+        return GetChunkByCoords(FloorDiv(x, chunkSize), FloorDiv(y, chunkHeight), FloorDiv(z, chunkSize));
     }
 
-    // Check if block exists at position using blockMap
-    bool IsBlockAtPosition(int x, int y, int z) {
-        BlockKey key = {x, y, z};
-        return blockMap.find(key) != blockMap.end();
+    // Packed light at a world position - anywhere outside the chunks counts as open sky
+    uint8_t GetLightAt(int x, int y, int z) const {
+        int cx = FloorDiv(x, chunkSize), cy = FloorDiv(y, chunkHeight), cz = FloorDiv(z, chunkSize);
+        const Chunk* chunk = GetChunkByCoords(cx, cy, cz);
+        if (!chunk) return OPEN_AIR_LIGHT;
+        return chunk->light[chunk->VoxelIndex(x - cx * chunkSize, y - cy * chunkHeight, z - cz * chunkSize)];
     }
 
-    // Remove block at position using blockMap
-    void RemoveBlockAtPosition(int x, int y, int z) {
-        BlockKey key = {x, y, z};
-        auto it = blockMap.find(key);
-        if (it != blockMap.end()) {
-            // Find the corresponding chunk
-            Chunk* chunk = GetChunkAt(x, y, z);
-            if (chunk) {
-                // Remove the block from the chunk's blocks vector
-                auto blockIt = std::remove_if(chunk->blocks.begin(), chunk->blocks.end(),
-                    [&](const Block& block) {
-                        return static_cast<int>(block.position.x) == x &&
-                               static_cast<int>(block.position.y) == y &&
-                               static_cast<int>(block.position.z) == z;
-                    });
-                if (blockIt != chunk->blocks.end()) {
-                    chunk->blocks.erase(blockIt, chunk->blocks.end());
+    // Block type at a world position - anywhere outside the chunks is air
+    BlockType GetBlockAt(int x, int y, int z) const {
+        int cx = FloorDiv(x, chunkSize), cy = FloorDiv(y, chunkHeight), cz = FloorDiv(z, chunkSize);
+        const Chunk* chunk = GetChunkByCoords(cx, cy, cz);
+        if (!chunk) return BlockType::Air;
+        return chunk->BlockAt(x - cx * chunkSize, y - cy * chunkHeight, z - cz * chunkSize);
+    }
+
+    // Bytes held by the block storage of every chunk
+    std::size_t BlockMemoryUsage() const {
+        std::size_t total = 0;
+        for (const Chunk& chunk : chunks) total += chunk.blocks.MemoryUsage();
+        return total;
+    }
+
+    // Flag the meshes of the chunk holding a position and of any chunk touching it - diagonals too, since ambient occlusion reads them
+    void MarkDirtyAround(int x, int y, int z) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (Chunk* chunk = GetChunkAt(x + dx, y + dy, z + dz)) chunk->meshDirty = true;
                 }
             }
-
-            // Remove from the blockMap
-            blockMap.erase(it);
         }
     }
 
-    // Add block at position using blockMap with BlockType
-    void AddBlockAtPosition(int x, int y, int z, BlockType type) {
-        BlockKey key = {x, y, z};
-        if (blockMap.find(key) != blockMap.end()) return; // Block already exists
+    // Check if block exists at position
+    bool IsBlockAtPosition(int x, int y, int z) const {
+        return GetBlockAt(x, y, z) != BlockType::Air;
+    }
 
-        Chunk* chunk = GetChunkAt(x, y, z);
-        if (!chunk) {
-            // Calculate new chunk offset based on block position
-            int chunkX = (x / chunkSize) * chunkSize;
-            int chunkY = (y / chunkHeight) * chunkHeight;
-            int chunkZ = (z / chunkSize) * chunkSize;
-
-            Vec3 chunkOffset = {
-                static_cast<float>(chunkX),
-                static_cast<float>(chunkY),
-                static_cast<float>(chunkZ)
-            };
+    // Check if a block at position hides its neighbours' faces
+    bool IsOpaqueBlockAt(int x, int y, int z) const {
+        return GetBlockInfo(GetBlockAt(x, y, z)).opaque;
+    }
 
-            // Create and add the new chunk
-            Chunk newChunk;
-            newChunk.GenerateFlatTerrain(chunkSize, chunkSize, chunkOffset, chunkHeight);
-            chunks.push_back(newChunk);
-            chunk = &chunks.back();
-
-            // Add new blocks from the new chunk to blockMap
-            for (const Block& block : chunk->blocks) {
-                BlockKey newKey = {static_cast<int>(block.position.x),
-                                   static_cast<int>(block.position.y),
-                                   static_cast<int>(block.position.z)};
-                blockMap[newKey] = block;
-            }
+    // Check if a block at position collides with the player and raycasts
+    bool IsSolidBlockAt(int x, int y, int z) const {
+        return GetBlockInfo(GetBlockAt(x, y, z)).solid;
+    }
+
+    // Change the block at a position to any type, air included, replacing whatever was there. Fluid placed this way is a source
+    void SetBlockAtPosition(int x, int y, int z, BlockType type) {
+        int cx = FloorDiv(x, chunkSize), cy = FloorDiv(y, chunkHeight), cz = FloorDiv(z, chunkSize);
+        Chunk* chunk = GetChunkByCoords(cx, cy, cz);
+        if (!chunk) {
+            if (type == BlockType::Air) return;
+            chunk = &CreateSection(cx, cy, cz); // First block in this section
         }
 
-        // Add the new block with the specified type
-        Block block;
-        block.position = Vec3(float(x), float(y), float(z));
-        block.type = type;
-        chunk->blocks.push_back(block);
-        blockMap[key] = block;
+        int i = chunk->VoxelIndex(x - cx * chunkSize, y - cy * chunkHeight, z - cz * chunkSize);
+        uint8_t fluid = IsFluid(type) ? FLUID_SOURCE | FLUID_FULL : 0;
+        if (chunk->blocks.Get(i) == type && chunk->FluidAt(i) == fluid) return;
+
+        chunk->blocks.Set(i, type);
+        chunk->SetFluid(i, fluid);
+        lightEdits.push_back({x, y, z});
+        blockUpdates.push_back({x, y, z});
+        fluidUpdates.push_back({x, y, z});
+        MarkDirtyAround(x, y, z);
+        version++;
+    }
+
+    // Remove block at position
+    void RemoveBlockAtPosition(int x, int y, int z) {
+        SetBlockAtPosition(x, y, z, BlockType::Air);
+    }
+
+    // Add block at position with BlockType
+    void AddBlockAtPosition(int x, int y, int z, BlockType type) {
+        if (IsSolidBlockAt(x, y, z)) return; // Block already exists - fluid gives way
+        SetBlockAtPosition(x, y, z, type);
     }
 };
 
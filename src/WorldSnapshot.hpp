@@ -0,0 +1,69 @@
+// WorldSnapshot.hpp
+#ifndef WORLD_SNAPSHOT_HPP
+#define WORLD_SNAPSHOT_HPP
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "ChunkMesh.hpp"
+
+// The parts of the camera the renderer needs
+struct CameraState {
+    Vec3 pos;
+    Vec3 lookDir;
+    float bobbingOffsetY = 0.0f;
+};
+
+// Everything the render thread needs for a frame, published by the simulation once per tick
+struct WorldSnapshot {
+    CameraState camera;
+    CameraState previousCamera; // Camera at the previous tick, for interpolating between ticks
+    std::chrono::steady_clock::time_point tickTime;
+
+    bool hasSelectedBlock = false;
+    Vec3 selectedBlockPosition;
+
+    uint32_t meshVersion = 0; // Changes whenever any mesh handle changes
+    std::vector<std::shared_ptr<const ChunkMesh>> meshes;
+
+    // Latest tick that had input, and when its earliest event happened - for input latency measurement
+    uint32_t inputSequence = 0;
+    std::chrono::steady_clock::time_point inputTime;
+};
+
+// Two snapshots - the simulation fills the back one while the renderer reads the front one, then Publish() swaps them
+class SnapshotBuffer {
+public:
+    // Simulation thread only
+    WorldSnapshot& Back() { return slots[1 - front]; }
+
+    void Publish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        front = 1 - front;
+    }
+
+    // Render thread - copies the front snapshot, only copying the mesh handles when they changed
+    void Read(WorldSnapshot& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const WorldSnapshot& snapshot = slots[front];
+        out.camera = snapshot.camera;
+        out.previousCamera = snapshot.previousCamera;
+        out.tickTime = snapshot.tickTime;
+        out.hasSelectedBlock = snapshot.hasSelectedBlock;
+        out.selectedBlockPosition = snapshot.selectedBlockPosition;
+        out.inputSequence = snapshot.inputSequence;
+        out.inputTime = snapshot.inputTime;
+        if (out.meshVersion != snapshot.meshVersion || out.meshes.size() != snapshot.meshes.size()) {
+            out.meshes = snapshot.meshes;
+            out.meshVersion = snapshot.meshVersion;
+        }
+    }
+
+private:
+    WorldSnapshot slots[2];
+    int front = 0;
+    std::mutex mutex;
+};
+
+#endif
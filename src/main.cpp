@@ -1,29 +1,68 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#endif
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include <unordered_map>
 #include <tuple>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include "PerlinNoise.hpp"
 #include "MatrixSupports.hpp"
 #include "WorldChunksBlocks.hpp"
+#include "Lighting.hpp"
+#include "BlockTicks.hpp"
+#include "Fluids.hpp"
+#include "ChunkMesh.hpp"
+#include "WorldSnapshot.hpp"
+#include "JobSystem.hpp"
+#include "FrameMemory.hpp"
+#include "DepthSort.hpp"
+#include "TextureAtlas.hpp"
+#include "Input.hpp"
+#include "Replay.hpp"
+#include "ResolutionScaler.hpp"
+#include "Clipping.hpp"
+#include "Raycast.hpp"
+#include "ImageFile.hpp"
+#include "NetSocket.hpp"
+#include "NetProtocol.hpp"
 
 // Screen Dimensions
 const int SCREEN_WIDTH = 1280;
 const int SCREEN_HEIGHT = 720;
 
-// Keyboard State Array
-bool keys[SDL_NUM_SCANCODES];
-
-// Mouse Movements
-int mouse_dx = 0, mouse_dy = 0;
-
-// Mouse Buttons
-bool leftMouseButtonDown = false;
-bool rightMouseButtonDown = false;
+// Input gathered on the main thread and handed to the simulation thread each tick
+InputQueue inputQueue;
+TickInput simInput;         // The simulation thread's input for the current tick
+uint32_t inputSequence = 0; // Simulation thread - ticks that had input, published for latency measurement
+InputClock::time_point inputTime; // Simulation thread - when the earliest event of that tick happened
+LatencyStats latencyStats;  // Render thread
+
+// Recording of the session for --record, and the edits the current tick made for it (simulation thread)
+ReplayWriter replayWriter;
+std::vector<ReplayEdit> tickEdits;
+bool headless = false; // Playing a recording back with no window - frames are drawn at the tick's camera without interpolation
+
+// Connection to a world server for --connect. The server owns the world - edits are sent to it and only happen here once they come
+// back in an edit batch, the same as everyone else's (simulation thread once the game is running)
+NetConnection server;
+bool networked = false;
+bool serverWelcomed = false;
+int serverWorldSize = 0, serverLowestSection = 0, serverHighestSection = -1;
+int sectionsWaiting = 0; // Requested and not yet received
+std::vector<uint8_t> netPayload;
+
+// Simulation runs at a fixed rate on its own thread
+const float SIM_TICK_SECONDS = 1.0f / 60.0f;
 
 // Constants
 const float PI = 3.1415926535f;
@@ -46,135 +85,141 @@ struct Camera {
 
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
-SDL_Texture* textureAtlas = nullptr;
-
-Mesh meshCube;
-Camera camera;
-World world;
-
-// SortedTriangle struct to store triangles with depth - this is used for painter's algorithm but it is not working correctly
-struct SortedTriangle {
-    Triangle tri;
-    float depth;
-    BlockType type;
-    Vec3 faceNormal;
+TextureAtlas atlas;
+
+Camera camera; // Owned by the simulation thread
+World world;   // Owned by the simulation thread - the renderer only sees it through snapshots
+
+// Simulation to render handoff
+SnapshotBuffer snapshots;
+CameraState publishedCamera; // Simulation thread - camera in the last published snapshot
+uint32_t meshVersion = 0;    // Simulation thread - bumped whenever a chunk mesh is rebuilt
+std::atomic<bool> simRunning{true};
+std::thread simThread;
+
+// Chunk meshes are built on a worker pool and swapped in by the simulation at the start of a tick
+const int MESH_WORKER_COUNT = 2;
+std::unique_ptr<JobSystem> meshJobs;
+
+struct FinishedMesh {
+    size_t chunk;
+    uint32_t sequence;
+    std::shared_ptr<const ChunkMesh> mesh;
+};
+
+std::mutex finishedMeshMutex;
+std::vector<FinishedMesh> finishedMeshes; // Guarded by finishedMeshMutex
+
+// Light updates after edits get a slice of each simulation tick - big changes finish over several ticks
+const float LIGHT_BUDGET_MS = 2.0f;
+LightEngine lightEngine(world); // Simulation thread
+
+// Grass spreading and falling sand, run every simulation tick after the player's own edits
+BlockTicker blockTicker(world); // Simulation thread
+FluidSimulation fluids(world);  // Simulation thread
+
+// Render thread's copy of the latest snapshot and the camera interpolated from it
+WorldSnapshot renderSnapshot;
+CameraState renderCamera;
+
+// Compact per-frame face (8 bytes) - its vertices are read back from the mesh when it is drawn
+struct PackedFace {
+    uint32_t chunk; // Index into renderSnapshot.meshes
+    uint32_t face;  // Index into that mesh's faces
+};
+
+// Reused every frame so steady-state frames do not touch the heap
+ScratchBuffer<PackedFace> visibleFaces;
+ScratchBuffer<SortKey> sortKeys;
+DepthSorter depthSorter;
+
+// Textured faces are drawn in batches - four vertices per quad sharing one 16-bit index pattern, built once at startup
+const int MAX_BATCH_QUADS = 16384; // 65536 vertices, as many as 16-bit indices can reach
+std::vector<uint16_t> quadIndices;
+ScratchBuffer<SDL_Vertex> batchVertices;
+
+// Temporal coherence - what visibleFaces was last gathered for, and what was last presented
+struct FrameCoherence {
+    bool gathered = false;
+    uint32_t meshVersion = 0;
+    int cellX = 0, cellY = 0, cellZ = 0; // Chunk cell the camera was in
+    Vec3 cullDir;                        // View direction used for chunk culling
+
+    bool presented = false;
+    Vec3 presentedPos;
+    Vec3 presentedLookDir;
+    bool presentedWireframe = false;
+    bool forceRedraw = false; // Set when the window needs repainting
 };
 
+FrameCoherence coherence;
+
+// Internal render resolution - below full size the world is drawn into the top left of sceneTarget and stretched over the window
+const float FRAME_TARGET_MS = 16.0f;
+ResolutionScaler resolutionScaler;
+SDL_Texture* sceneTarget = nullptr; // Stays null when headless or when the renderer can't draw to textures, which keeps full size
+int renderWidth = SCREEN_WIDTH;
+int renderHeight = SCREEN_HEIGHT;
+
+bool running = true;
 bool wireframeMode = false;
 Vec3 selectedBlockPosition;
 bool hasSelectedBlock = false;
 
-// Initialise Cube Mesh
-void InitCubeMesh() {
-    // Vertices with corrected positions and default texture coordinates
-    Vertex verts[] = {
-        Vertex({0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}), // 0 - Bottom-left corner (Front)
-        Vertex({0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}), // 1 - Top-left corner (Front)
-        Vertex({1.0f, 1.0f, 0.0f}, {1.0f, 0.0f}), // 2 - Top-right corner (Front)
-        Vertex({1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}), // 3 - Bottom-right corner (Front)
-        Vertex({0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}), // 4 - Bottom-left corner (Back)
-        Vertex({0.0f, 1.0f, 1.0f}, {0.0f, 0.0f}), // 5 - Top-left corner (Back)
-        Vertex({1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}), // 6 - Top-right corner (Back)
-        Vertex({1.0f, 0.0f, 1.0f}, {1.0f, 1.0f})  // 7 - Bottom-right corner (Back)
-    };
+// What the right button places - picked with the number keys (simulation thread)
+const BlockType PLACEABLE_BLOCKS[] = { BlockType::OakWood, BlockType::Sand, BlockType::Water, BlockType::Lava };
+BlockType placeType = BlockType::OakWood;
+
+// Centre of a mesh face in world space, used for depth sorting
+Vec3 FaceCentre(const ChunkMesh& mesh, uint32_t face) {
+    const MeshVertex* corners = &mesh.vertices[face * 4];
+    int x = corners[0].x + corners[1].x + corners[2].x + corners[3].x;
+    int y = corners[0].y + corners[1].y + corners[2].y + corners[3].y;
+    int z = corners[0].z + corners[1].z + corners[2].z + corners[3].z;
+    return mesh.offset + Vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) * 0.25f;
+}
 
-    // Front face (z=0)
-    Face frontFace;
-    frontFace.tris[0].v[0] = Vertex(verts[0].pos, {0.0f, 1.0f}); // Bottom-left
-    frontFace.tris[0].v[1] = Vertex(verts[1].pos, {0.0f, 0.0f}); // Top-left
-    frontFace.tris[0].v[2] = Vertex(verts[2].pos, {1.0f, 0.0f}); // Top-right
-
-    frontFace.tris[1].v[0] = Vertex(verts[0].pos, {0.0f, 1.0f}); // Bottom-left
-    frontFace.tris[1].v[1] = Vertex(verts[2].pos, {1.0f, 0.0f}); // Top-right
-    frontFace.tris[1].v[2] = Vertex(verts[3].pos, {1.0f, 1.0f}); // Bottom-right
-    frontFace.normal = {0.0f, 0.0f, -1.0f};
-
-    // Right face (x=1)
-    Face rightFace;
-    rightFace.tris[0].v[0] = Vertex(verts[3].pos, {0.0f, 1.0f}); // Bottom-left
-    rightFace.tris[0].v[1] = Vertex(verts[2].pos, {0.0f, 0.0f}); // Top-left
-    rightFace.tris[0].v[2] = Vertex(verts[6].pos, {1.0f, 0.0f}); // Top-right
-
-    rightFace.tris[1].v[0] = Vertex(verts[3].pos, {0.0f, 1.0f}); // Bottom-left
-    rightFace.tris[1].v[1] = Vertex(verts[6].pos, {1.0f, 0.0f}); // Top-right
-    rightFace.tris[1].v[2] = Vertex(verts[7].pos, {1.0f, 1.0f}); // Bottom-right
-    rightFace.normal = {1.0f, 0.0f, 0.0f};
-
-    // Back face (z=1)
-    Face backFace;
-    backFace.tris[0].v[0] = Vertex(verts[7].pos, {0.0f, 1.0f}); // Bottom-left
-    backFace.tris[0].v[1] = Vertex(verts[6].pos, {0.0f, 0.0f}); // Top-left
-    backFace.tris[0].v[2] = Vertex(verts[5].pos, {1.0f, 0.0f}); // Top-right
-
-    backFace.tris[1].v[0] = Vertex(verts[7].pos, {0.0f, 1.0f}); // Bottom-left
-    backFace.tris[1].v[1] = Vertex(verts[5].pos, {1.0f, 0.0f}); // Top-right
-    backFace.tris[1].v[2] = Vertex(verts[4].pos, {1.0f, 1.0f}); // Bottom-right
-    backFace.normal = {0.0f, 0.0f, 1.0f};
-
-    // Left face (x=0)
-    Face leftFace;
-    leftFace.tris[0].v[0] = Vertex(verts[4].pos, {0.0f, 1.0f}); // Bottom-left
-    leftFace.tris[0].v[1] = Vertex(verts[5].pos, {0.0f, 0.0f}); // Top-left
-    leftFace.tris[0].v[2] = Vertex(verts[1].pos, {1.0f, 0.0f}); // Top-right
-
-    leftFace.tris[1].v[0] = Vertex(verts[4].pos, {0.0f, 1.0f}); // Bottom-left
-    leftFace.tris[1].v[1] = Vertex(verts[1].pos, {1.0f, 0.0f}); // Top-right
-    leftFace.tris[1].v[2] = Vertex(verts[0].pos, {1.0f, 1.0f}); // Bottom-right
-    leftFace.normal = {-1.0f, 0.0f, 0.0f};
-
-    // Top face (y=1)
-    Face topFace;
-    topFace.tris[0].v[0] = Vertex(verts[1].pos, {0.0f, 0.0f}); // Top-left
-    topFace.tris[0].v[1] = Vertex(verts[5].pos, {0.0f, 1.0f}); // Bottom-left
-    topFace.tris[0].v[2] = Vertex(verts[6].pos, {1.0f, 1.0f}); // Bottom-right
-
-    topFace.tris[1].v[0] = Vertex(verts[1].pos, {0.0f, 0.0f}); // Top-left
-    topFace.tris[1].v[1] = Vertex(verts[6].pos, {1.0f, 1.0f}); // Bottom-right
-    topFace.tris[1].v[2] = Vertex(verts[2].pos, {1.0f, 0.0f}); // Top-right
-    topFace.normal = {0.0f, 1.0f, 0.0f};
-
-    // Bottom face (y=0)
-    Face bottomFace;
-    bottomFace.tris[0].v[0] = Vertex(verts[4].pos, {0.0f, 1.0f}); // Bottom-left
-    bottomFace.tris[0].v[1] = Vertex(verts[0].pos, {0.0f, 0.0f}); // Top-left
-    bottomFace.tris[0].v[2] = Vertex(verts[3].pos, {1.0f, 0.0f}); // Top-right
-
-    bottomFace.tris[1].v[0] = Vertex(verts[4].pos, {0.0f, 1.0f}); // Bottom-left
-    bottomFace.tris[1].v[1] = Vertex(verts[3].pos, {1.0f, 0.0f}); // Top-right
-    bottomFace.tris[1].v[2] = Vertex(verts[7].pos, {1.0f, 1.0f}); // Bottom-right
-    bottomFace.normal = {0.0f, -1.0f, 0.0f};
-
-    // Add all faces to the cube mesh
-    meshCube.faces.push_back(frontFace);
-    meshCube.faces.push_back(rightFace);
-    meshCube.faces.push_back(backFace);
-    meshCube.faces.push_back(leftFace);
-    meshCube.faces.push_back(topFace);
-    meshCube.faces.push_back(bottomFace);
+// World-space vertex for one corner of a packed face
+Vertex UnpackVertex(const ChunkMesh& mesh, uint32_t face, int corner) {
+    const MeshVertex& vertex = mesh.vertices[face * 4 + corner];
+    Vertex out(mesh.offset + Vec3(vertex.x, vertex.y, vertex.z), Vec2(vertex.u, vertex.v));
+    out.light = vertex.shade * (1.0f / 255.0f);
+    return out;
+}
+
+// Rebuild one of a packed face's two world-space triangles
+Triangle UnpackTriangle(const PackedFace& packed, int tri) {
+    const ChunkMesh& mesh = *renderSnapshot.meshes[packed.chunk];
+    Triangle out;
+    for (int j = 0; j < 3; ++j) out.v[j] = UnpackVertex(mesh, packed.face, TRI_CORNERS[tri][j]);
+    return out;
+}
+
+// Repeat the 0,1,2 0,2,3 quad pattern for a full batch
+void InitQuadIndices() {
+    quadIndices.resize(MAX_BATCH_QUADS * 6);
+    for (int q = 0; q < MAX_BATCH_QUADS; q++) {
+        for (int i = 0; i < 6; i++) quadIndices[q * 6 + i] = static_cast<uint16_t>(q * 4 + TRI_CORNERS[i / 3][i % 3]);
+    }
 }
 
 // Handle User Input Events
 void HandleInput() {
     SDL_Event event;
-    mouse_dx = mouse_dy = 0;
     while (SDL_PollEvent(&event)) {
+        inputQueue.Record(event);
+
         if (event.type == SDL_QUIT) {
+#ifdef __EMSCRIPTEN__
             emscripten_cancel_main_loop();
+#else
+            running = false;
+#endif
+        } else if (event.type == SDL_WINDOWEVENT) {
+            coherence.forceRedraw = true;
         } else if (event.type == SDL_KEYDOWN) {
-            keys[event.key.keysym.scancode] = true;
             // User can switch between wireframe and solid mode by pressing 'X'
             if (event.key.keysym.scancode == SDL_SCANCODE_X) wireframeMode = !wireframeMode;
-        } else if (event.type == SDL_KEYUP) {
-            keys[event.key.keysym.scancode] = false;
-        } else if (event.type == SDL_MOUSEMOTION) {
-            mouse_dx = event.motion.xrel;
-            mouse_dy = event.motion.yrel;
-        } else if (event.type == SDL_MOUSEBUTTONDOWN) {
-            if (event.button.button == SDL_BUTTON_LEFT) {
-                leftMouseButtonDown = true;
-            } else if (event.button.button == SDL_BUTTON_RIGHT) {
-                rightMouseButtonDown = true;
-            }
         }
     }
 }
@@ -194,7 +239,7 @@ bool CheckCollision(const Vec3& pos, bool checkX, bool checkY, bool checkZ) {
     for (int x = minX; x <= maxX; x++) {
         for (int y = minY; y <= maxY; y++) {
             for (int z = minZ; z <= maxZ; z++) {
-                if (world.IsBlockAtPosition(x, y, z)) {
+                if (world.IsSolidBlockAt(x, y, z)) {
                     // Check which axes are involved in the collision
                     bool collision = false;
                     if (checkX && x >= floor(pos.x - playerWidth) && x <= floor(pos.x + playerWidth)) collision = true;
@@ -209,28 +254,6 @@ bool CheckCollision(const Vec3& pos, bool checkX, bool checkY, bool checkZ) {
     return false;
 }
 
-// Texture Atlas Settings
-const int TEX_SIZE = 16;
-const int ATLAS_COLUMNS = 5; // Number of textures horizontally
-const int ATLAS_WIDTH = ATLAS_COLUMNS * TEX_SIZE; // Total width of the atlas in pixels
-const int ATLAS_HEIGHT = 16; // Total height of the atlas in pixels
-
-// Texture coordinates based on BlockType
-std::unordered_map<BlockType, Vec2> blockTextureOffsets = {
-    { BlockType::Stone,     Vec2(0.0f, 0.0f) },     // Column 0
-    { BlockType::Dirt,      Vec2(1.0f, 0.0f) },     // Column 1
-    { BlockType::OakWood,   Vec2(2.0f, 0.0f) },     // Column 2
-    { BlockType::GrassSide, Vec2(4.0f, 0.0f) }      // Column 4
-};
-
-
-// Update texture coordinates based on BlockType
-Vec2 GetTextureOffset(BlockType type) {
-    if (blockTextureOffsets.find(type) != blockTextureOffsets.end()) { return blockTextureOffsets[type]; }
-    // Default to Stone texture if not found - need to swap it with a missing texture
-    return Vec2(0.0f, 0.0f);
-}
-
 // Helper function to project 3D points to 2D screen space
 bool ProjectToScreen(const Vec3& point, const Mat4& matView, const Mat4& matProj, Vec2& screenPoint) {
     Vec3 transformed = MultiplyMatrixVector(point, matView);
@@ -243,16 +266,16 @@ bool ProjectToScreen(const Vec3& point, const Mat4& matView, const Mat4& matProj
     projected.y /= projected.z;
 
     // Convert to screen coordinates
-    screenPoint.u = (projected.x + 1.0f) * 0.5f * SCREEN_WIDTH;
-    screenPoint.v = (1.0f - (projected.y + 1.0f) * 0.5f) * SCREEN_HEIGHT;
+    screenPoint.u = (projected.x + 1.0f) * 0.5f * renderWidth;
+    screenPoint.v = (1.0f - (projected.y + 1.0f) * 0.5f) * renderHeight;
 
     return true;
 }
 
-// Update camera and scene
-void Update(float deltaTime) {
-    camera.yaw += mouse_dx * 0.1f;
-    camera.pitch -= mouse_dy * 0.1f;
+// Turn the camera by a mouse movement
+void ApplyMouseLook(int dx, int dy) {
+    camera.yaw += dx * 0.1f;
+    camera.pitch -= dy * 0.1f;
 
     if (camera.pitch > 89.0f) camera.pitch = 89.0f;
     if (camera.pitch < -89.0f) camera.pitch = -89.0f;
@@ -262,6 +285,138 @@ void Update(float deltaTime) {
         sinf(camera.pitch * PI / 180.0f),
         cosf(camera.pitch * PI / 180.0f) * cosf(camera.yaw * PI / 180.0f)
     };
+}
+
+// Ask the server for an edit
+void SendEdit(uint8_t added, int x, int y, int z, BlockType type) {
+    netPayload.clear();
+    NetWriter writer(netPayload);
+    writer.Edit({ added, x, y, z, static_cast<uint8_t>(type) });
+    server.Send(MSG_EDIT, netPayload);
+}
+
+// Apply whatever the server has sent since the last call
+void PollServer() {
+    if (!server.Receive()) {
+        printf("Lost the connection to the server, carrying on alone\n");
+        networked = false;
+        return;
+    }
+
+    uint8_t type;
+    const uint8_t* data;
+    uint32_t size;
+    while (server.NextMessage(type, data, size)) {
+        NetReader reader(data, size);
+        if (type == MSG_WELCOME) {
+            serverWorldSize = reader.I32();
+            serverLowestSection = reader.I32();
+            serverHighestSection = reader.I32();
+            serverWelcomed = reader.ok;
+        } else if (type == MSG_SECTION) {
+            if (!ReceiveSection(world, reader)) printf("Bad section from the server\n");
+            sectionsWaiting--;
+        } else if (type == MSG_EDITS) {
+            reader.U32();
+            int count = reader.U16();
+            for (int i = 0; i < count; i++) {
+                BlockEdit edit = reader.Edit();
+                if (!reader.ok) break;
+                ApplyBlockEdit(world, edit);
+            }
+        }
+    }
+}
+
+// Wait for the server until done() or the timeout - only used before the simulation thread starts
+template <typename Done>
+bool WaitForServer(Done done, int timeoutMs) {
+    uint32_t start = SDL_GetTicks();
+    while (networked && !done()) {
+        if (SDL_GetTicks() - start > static_cast<uint32_t>(timeoutMs)) return false;
+        server.Flush();
+        server.WaitReadable(10);
+        PollServer();
+    }
+    return networked;
+}
+
+// Connect and fetch every section of the server's world, in place of generating one
+bool DownloadWorld(const char* host, uint16_t port) {
+    if (!server.Connect(host, port)) return false;
+    networked = true;
+    world.Initialise();
+
+    netPayload.clear();
+    NetWriter(netPayload).U32(NET_PROTOCOL_VERSION);
+    server.Send(MSG_HELLO, netPayload);
+    if (!WaitForServer([] { return serverWelcomed; }, 5000)) return false;
+    world.worldSize = serverWorldSize;
+
+    for (int cx = 0; cx < serverWorldSize; cx++) {
+        for (int cz = 0; cz < serverWorldSize; cz++) {
+            for (int cy = serverLowestSection; cy <= serverHighestSection; cy++) {
+                netPayload.clear();
+                NetWriter writer(netPayload);
+                writer.I32(cx);
+                writer.I32(cy);
+                writer.I32(cz);
+                server.Send(MSG_REQUEST_SECTION, netPayload);
+                sectionsWaiting++;
+            }
+        }
+    }
+    return WaitForServer([] { return sectionsWaiting == 0; }, 10000);
+}
+
+// Break (left button) or place (right button) the block the camera is looking at
+void EditBlock(uint8_t button) {
+    Vec3 hitBlockPosition, hitNormal;
+    float maxDistance = 8.0f;
+    if (!CastRay(world, camera.pos, camera.lookDir, maxDistance, hitBlockPosition, hitNormal)) return;
+
+    int hx = int(hitBlockPosition.x);
+    int hy = int(hitBlockPosition.y);
+    int hz = int(hitBlockPosition.z);
+
+    uint32_t versionBefore = world.version;
+    if (button == SDL_BUTTON_LEFT) {
+        if (networked) {
+            SendEdit(0, hx, hy, hz, BlockType::Air);
+            return;
+        }
+        uint8_t removedType = static_cast<uint8_t>(world.GetBlockAt(hx, hy, hz));
+        world.RemoveBlockAtPosition(hx, hy, hz);
+        if (world.version != versionBefore) tickEdits.push_back({ 0, hx, hy, hz, removedType });
+    } else if (button == SDL_BUTTON_RIGHT) {
+        // Calculate the new block position based on the hit position and normal
+        Vec3 newBlockPos = hitBlockPosition + hitNormal;
+        BlockType newType = placeType;
+        if (networked) {
+            SendEdit(1, int(newBlockPos.x), int(newBlockPos.y), int(newBlockPos.z), newType);
+            return;
+        }
+        world.AddBlockAtPosition(int(newBlockPos.x), int(newBlockPos.y), int(newBlockPos.z), newType);
+        if (world.version != versionBefore) tickEdits.push_back({ 1, int(newBlockPos.x), int(newBlockPos.y), int(newBlockPos.z), static_cast<uint8_t>(newType) });
+    }
+}
+
+// Update camera and scene
+void Update(float deltaTime) {
+    // Number keys pick what the right button places
+    for (std::size_t k = 0; k < sizeof(PLACEABLE_BLOCKS) / sizeof(PLACEABLE_BLOCKS[0]); k++) {
+        if (simInput.keys[SDL_SCANCODE_1 + k]) placeType = PLACEABLE_BLOCKS[k];
+    }
+
+    // Every click this tick, in order, each aimed with the motion that came before it
+    int appliedDx = 0, appliedDy = 0;
+    for (const ButtonPress& press : simInput.presses) {
+        ApplyMouseLook(press.mouseDx - appliedDx, press.mouseDy - appliedDy);
+        appliedDx = press.mouseDx;
+        appliedDy = press.mouseDy;
+        EditBlock(press.button);
+    }
+    ApplyMouseLook(simInput.mouseDx - appliedDx, simInput.mouseDy - appliedDy);
 
     // Calculate forward and right vectors based on yaw only
     float yawRad = camera.yaw * PI / 180.0f;
@@ -286,10 +441,10 @@ void Update(float deltaTime) {
     Vec3 moveDir = {0, 0, 0};
 
     // Accumulate movement based on input
-    if (keys[SDL_SCANCODE_W]) moveDir = moveDir + forward * deltaTime * speed;
-    if (keys[SDL_SCANCODE_S]) moveDir = moveDir - forward * deltaTime * speed;
-    if (keys[SDL_SCANCODE_A]) moveDir = moveDir - right * deltaTime * speed;
-    if (keys[SDL_SCANCODE_D]) moveDir = moveDir + right * deltaTime * speed;
+    if (simInput.keys[SDL_SCANCODE_W]) moveDir = moveDir + forward * deltaTime * speed;
+    if (simInput.keys[SDL_SCANCODE_S]) moveDir = moveDir - forward * deltaTime * speed;
+    if (simInput.keys[SDL_SCANCODE_A]) moveDir = moveDir - right * deltaTime * speed;
+    if (simInput.keys[SDL_SCANCODE_D]) moveDir = moveDir + right * deltaTime * speed;
 
     // Move in X and check collision
     camera.pos.x += moveDir.x;
@@ -300,7 +455,7 @@ void Update(float deltaTime) {
     if (CheckCollision(camera.pos, false, false, true)) camera.pos.z = oldPosition.z;
 
     // Handle jumping and gravity in the Y-axis
-    if (keys[SDL_SCANCODE_SPACE] && camera.isOnGround) {
+    if (simInput.keys[SDL_SCANCODE_SPACE] && camera.isOnGround) {
         camera.verticalVelocity = 6.0f; // Jump velocity
         camera.isOnGround = false;
     }
@@ -326,7 +481,7 @@ void Update(float deltaTime) {
     }
 
     // View Bobbing Logic
-    bool isMoving = keys[SDL_SCANCODE_W] || keys[SDL_SCANCODE_S] || keys[SDL_SCANCODE_A] || keys[SDL_SCANCODE_D];
+    bool isMoving = simInput.keys[SDL_SCANCODE_W] || simInput.keys[SDL_SCANCODE_S] || simInput.keys[SDL_SCANCODE_A] || simInput.keys[SDL_SCANCODE_D];
     if (isMoving && camera.isOnGround) {
         // Increment the bobbing timer
         camera.bobbingTimer += deltaTime * camera.bobbingFrequency;
@@ -340,32 +495,10 @@ void Update(float deltaTime) {
         camera.bobbingTimer = 0.0f;
     }
 
-    // Handle block placement and deletion
-    if (leftMouseButtonDown || rightMouseButtonDown) {
-        Vec3 hitBlockPosition, hitNormal;
-        float maxDistance = 8.0f;
-        if (CastRay(camera.pos, camera.lookDir, maxDistance, hitBlockPosition, hitNormal)) {
-            int hx = int(hitBlockPosition.x);
-            int hy = int(hitBlockPosition.y);
-            int hz = int(hitBlockPosition.z);
-
-            if (leftMouseButtonDown) {
-                world.RemoveBlockAtPosition(hx, hy, hz);
-            } else if (rightMouseButtonDown) {
-                // Calculate the new block position based on the hit position and normal
-                Vec3 newBlockPos = hitBlockPosition + hitNormal;
-                BlockType newType = BlockType::OakWood; // Currently the player can only place OakWood blocks
-                world.AddBlockAtPosition(int(newBlockPos.x), int(newBlockPos.y), int(newBlockPos.z), newType);
-            }
-        }
-    }
-
-    leftMouseButtonDown = false;
-    rightMouseButtonDown = false;
     {
         Vec3 hitBlockPos, hitNorm;
         float selectionDistance = 8.0f;
-        if (CastRay(camera.pos, camera.lookDir, selectionDistance, hitBlockPos, hitNorm)) {
+        if (CastRay(world, camera.pos, camera.lookDir, selectionDistance, hitBlockPos, hitNorm)) {
             selectedBlockPosition = hitBlockPos;
             hasSelectedBlock = true;
         }
@@ -375,47 +508,76 @@ void Update(float deltaTime) {
     }
 }
 
+// Size this frame's render from the current scale and point drawing at the scene target when it's below full size
+void BeginScene() {
+    float scale = sceneTarget ? resolutionScaler.Scale() : 1.0f;
+    renderWidth = std::max(1, static_cast<int>(lroundf(SCREEN_WIDTH * scale)));
+    renderHeight = std::max(1, static_cast<int>(lroundf(SCREEN_HEIGHT * scale)));
+    if (renderWidth < SCREEN_WIDTH || renderHeight < SCREEN_HEIGHT) SDL_SetRenderTarget(renderer, sceneTarget);
+}
+
+// Stretch a scaled down scene over the whole window - the overlay is drawn after this at full resolution
+void EndScene() {
+    if (renderWidth == SCREEN_WIDTH && renderHeight == SCREEN_HEIGHT) return;
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_Rect source = { 0, 0, renderWidth, renderHeight };
+    SDL_RenderCopy(renderer, sceneTarget, &source, nullptr);
+}
+
 void ClearScreen() {
     // Blue Sky Background
     SDL_SetRenderDrawColor(renderer, 135, 206, 235, 255);
     SDL_RenderClear(renderer);
 }
 
-// Draw a triangle using SDL_RenderGeometry with adjusted texture coordinates
-void DrawTriangle(const Triangle& tri, BlockType type, const Vec3& faceNormal) {
-    SDL_Vertex vertices[3];
-
-    // Determine texture offset based on BlockType and face normal
-    Vec2 texOffset;
+// Submit the batched quads in one call
+void FlushBatch() {
+    int vertexCount = static_cast<int>(batchVertices.size());
+    if (vertexCount == 0) return;
+
+    const SDL_Vertex* first = &batchVertices[0];
+    SDL_RenderGeometryRaw(renderer, atlas.texture,
+                          &first->position.x, sizeof(SDL_Vertex),
+                          &first->color, sizeof(SDL_Vertex),
+                          &first->tex_coord.x, sizeof(SDL_Vertex),
+                          vertexCount, quadIndices.data(), vertexCount / 4 * 6, sizeof(uint16_t));
+    batchVertices.Reset();
+}
 
-    // Grass is slightly different as it has a top and side texture - this should really be handled in a more general way - future me, please fix this 😇
-    if (type == BlockType::Grass)
-    {
-        if (faceNormal.y > 0.5f) texOffset = Vec2(3.0f, 0.0f);
-        else if (faceNormal.y < -0.5f) texOffset = blockTextureOffsets[BlockType::Dirt];
-        else texOffset = blockTextureOffsets[BlockType::GrassSide];
-    }
-    else
-    {
-        // Use the standard texture for the block type
-        texOffset = GetTextureOffset(type);
+// Add a screen-space quad to the batch, sampling the atlas mip that suits its size on screen. A lone triangle is passed with its last corner
+// repeated, which makes the quad's second triangle empty
+void DrawQuad(const Vertex* quad, uint8_t tile) {
+    // Texels covered against pixels covered - both from the diagonals' cross product, so the scale cancels out
+    Vec2 t1 = quad[2].tex - quad[0].tex, t2 = quad[3].tex - quad[1].tex;
+    float texelArea = fabsf(t1.u * t2.v - t1.v * t2.u) * (TEX_SIZE * TEX_SIZE);
+    float pixelArea = fabsf((quad[2].pos.x - quad[0].pos.x) * (quad[3].pos.y - quad[1].pos.y) -
+                            (quad[2].pos.y - quad[0].pos.y) * (quad[3].pos.x - quad[1].pos.x));
+    const AtlasRect& rect = atlas.Rect(tile, TextureAtlas::SelectMip(texelArea, pixelArea));
+
+    for (int i = 0; i < 4; ++i) {
+        SDL_Vertex vertex;
+        uint8_t shade = static_cast<uint8_t>(quad[i].light * 255.0f + 0.5f);
+        vertex.position.x = quad[i].pos.x;
+        vertex.position.y = quad[i].pos.y;
+        vertex.color.r = shade;
+        vertex.color.g = shade;
+        vertex.color.b = shade;
+        vertex.color.a = 255;
+        vertex.tex_coord.x = rect.u0 + quad[i].tex.u * (rect.u1 - rect.u0);
+        vertex.tex_coord.y = rect.v0 + quad[i].tex.v * (rect.v1 - rect.v0);
+        batchVertices.push_back(vertex);
     }
 
-    float scaleU = 1.0f / static_cast<float>(ATLAS_COLUMNS);
-    float scaleV = 1.0f / static_cast<float>(ATLAS_HEIGHT / TEX_SIZE);
-
-    for (int i = 0; i < 3; ++i) {
-        vertices[i].position.x = tri.v[i].pos.x;
-        vertices[i].position.y = tri.v[i].pos.y;
-        vertices[i].color.r = 255;
-        vertices[i].color.g = 255;
-        vertices[i].color.b = 255;
-        vertices[i].color.a = 255;
-        vertices[i].tex_coord.x = texOffset.u * scaleU + tri.v[i].tex.u * scaleU;
-        vertices[i].tex_coord.y = texOffset.v * scaleV + tri.v[i].tex.v * scaleV;
-    }
+    if (batchVertices.size() == static_cast<size_t>(MAX_BATCH_QUADS * 4)) FlushBatch();
+}
 
-    SDL_RenderGeometry(renderer, textureAtlas, vertices, 3, NULL, 0);
+// View space to screen space
+Vertex ProjectVertex(const Vertex& v, const Mat4& matProj) {
+    Vertex out = v;
+    out.pos = MultiplyMatrixVector(v.pos, matProj);
+    out.pos.x = (out.pos.x + 1.0f) * 0.5f * renderWidth;
+    out.pos.y = (1.0f - (out.pos.y + 1.0f) * 0.5f) * renderHeight;
+    return out;
 }
 
 // Function to draw wireframe triangles
@@ -431,151 +593,6 @@ void DrawWireframe(const Triangle& tri) {
                                (int)tri.v[0].pos.x, (int)tri.v[0].pos.y);
 }
 
-// Draw the world
-Vertex IntersectPlane(const Vec3 &plane_p, const Vec3 &plane_n, const Vertex &lineStart, const Vertex &lineEnd, float &t) {
-    Vec3 plane_n_norm = plane_n.normalize();
-    float plane_d = -plane_n_norm.dot(plane_p);
-    float ad = lineStart.pos.dot(plane_n_norm);
-    float bd = lineEnd.pos.dot(plane_n_norm);
-    float denominator = bd - ad;
-    if (fabs(denominator) < 1e-6f) {
-        t = 0.0f;
-        return lineStart;
-    }
-    t = (-plane_d - ad) / denominator;
-    Vec3 lineStartToEnd = lineEnd.pos - lineStart.pos;
-    Vec3 intersectionPoint = lineStart.pos + lineStartToEnd * t;
-
-    Vec2 texStartToEnd = lineEnd.tex - lineStart.tex;
-    Vec2 intersectionTex = lineStart.tex + texStartToEnd * t;
-
-    return Vertex(intersectionPoint, intersectionTex);
-}
-
-// Clipping triangle against near plane (returns the number of output triangles)
-int TriangleClipAgainstPlane(const Vec3 &plane_p, const Vec3 &plane_n, const Triangle &inTri, Triangle &outTri1, Triangle &outTri2) {
-    Vec3 plane_n_norm = plane_n.normalize();
-
-    auto dist = [&](const Vertex &v) {
-        Vec3 n = v.pos - plane_p;
-        return plane_n_norm.dot(n);
-    };
-
-    const Vertex *inside_points[3];  int nInsidePointCount = 0;
-    const Vertex *outside_points[3]; int nOutsidePointCount = 0;
-
-    float d0 = dist(inTri.v[0]);
-    float d1 = dist(inTri.v[1]);
-    float d2 = dist(inTri.v[2]);
-
-    if (d0 >= 0) inside_points[nInsidePointCount++] = &inTri.v[0]; else outside_points[nOutsidePointCount++] = &inTri.v[0];
-    if (d1 >= 0) inside_points[nInsidePointCount++] = &inTri.v[1]; else outside_points[nOutsidePointCount++] = &inTri.v[1];
-    if (d2 >= 0) inside_points[nInsidePointCount++] = &inTri.v[2]; else outside_points[nOutsidePointCount++] = &inTri.v[2];
-
-    if (nInsidePointCount == 0)  return 0;
-
-    float t;
-    if (nInsidePointCount == 3) {
-        outTri1 = inTri;
-        return 1;
-    }
-
-    if (nInsidePointCount == 1 && nOutsidePointCount == 2) {
-        outTri1.v[0] = *inside_points[0];
-        outTri1.v[1] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[0], t);
-        outTri1.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[1], t);
-        return 1;
-    }
-
-    if (nInsidePointCount == 2 && nOutsidePointCount == 1) {
-        outTri1.v[0] = *inside_points[0];
-        outTri1.v[1] = *inside_points[1];
-        outTri1.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[0], *outside_points[0], t);
-
-        outTri2.v[0] = *inside_points[1];
-        outTri2.v[1] = outTri1.v[2];
-        outTri2.v[2] = IntersectPlane(plane_p, plane_n_norm, *inside_points[1], *outside_points[0], t);
-        return 2;
-    }
-
-    return 0;
-}
-
-// Raycasting function using 3D DDA algorithm
-bool CastRay(Vec3 origin, Vec3 direction, float maxDistance, Vec3& hitBlockPosition, Vec3& hitNormal) {
-    direction = direction.normalize();
-
-    float dx = direction.x;
-    float dy = direction.y;
-    float dz = direction.z;
-
-    int ix = int(floor(origin.x));
-    int iy = int(floor(origin.y));
-    int iz = int(floor(origin.z));
-
-    int stepX = (dx > 0) ? 1 : ((dx < 0) ? -1 : 0);
-    int stepY = (dy > 0) ? 1 : ((dy < 0) ? -1 : 0);
-    int stepZ = (dz > 0) ? 1 : ((dz < 0) ? -1 : 0);
-
-    float tMaxX, tMaxY, tMaxZ;
-    float tDeltaX = (dx != 0) ? fabs(1.0f / dx) : 1e30;
-    float tDeltaY = (dy != 0) ? fabs(1.0f / dy) : 1e30;
-    float tDeltaZ = (dz != 0) ? fabs(1.0f / dz) : 1e30;
-
-    if (dx != 0) {
-        float voxelBoundaryX = (dx > 0) ? (ix + 1) : ix;
-        tMaxX = (voxelBoundaryX - origin.x) / dx;
-    } else {
-        tMaxX = 1e30;
-    }
-
-    if (dy != 0) {
-        float voxelBoundaryY = (dy > 0) ? (iy + 1) : iy;
-        tMaxY = (voxelBoundaryY - origin.y) / dy;
-    } else {
-        tMaxY = 1e30;
-    }
-
-    if (dz != 0) {
-        float voxelBoundaryZ = (dz > 0) ? (iz + 1) : iz;
-        tMaxZ = (voxelBoundaryZ - origin.z) / dz;
-    } else {
-        tMaxZ = 1e30;
-    }
-
-    float t = 0;
-    int maxSteps = 1000;
-
-    for (int i = 0; i < maxSteps; i++) {
-        if (world.IsBlockAtPosition(ix, iy, iz)) {
-            hitBlockPosition = Vec3(float(ix), float(iy), float(iz));
-
-            if (tMaxX < tMaxY && tMaxX < tMaxZ)  hitNormal = Vec3(-stepX, 0, 0);
-            else if (tMaxY < tMaxZ)  hitNormal = Vec3(0, -stepY, 0);
-            else  hitNormal = Vec3(0, 0, -stepZ);
-            return true;
-        }
-
-        if (tMaxX < tMaxY && tMaxX < tMaxZ) {
-            ix += stepX;
-            t = tMaxX;
-            tMaxX += tDeltaX;
-        } else if (tMaxY < tMaxZ) {
-            iy += stepY;
-            t = tMaxY;
-            tMaxY += tDeltaY;
-        } else {
-            iz += stepZ;
-            t = tMaxZ;
-            tMaxZ += tDeltaZ;
-        }
-
-        if (t > maxDistance) break;
-    }
-
-    return false;
-}
-
 // Draw the crosshair at the center of the screen
 void DrawCrosshair() {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
@@ -592,7 +609,7 @@ void DrawCrosshair() {
 // Draw the outline around the selected block by outlining its edges
 void DrawBlockOutline(const Vec3& blockPos, const Mat4& matView, const Mat4& matProj) {
     // Define the 8 corners of the block
-    std::vector<Vec3> corners = {
+    const Vec3 corners[8] = {
         {blockPos.x, blockPos.y, blockPos.z},                       // Corner 0
         {blockPos.x + 1.0f, blockPos.y, blockPos.z},                // Corner 1
         {blockPos.x + 1.0f, blockPos.y + 1.0f, blockPos.z},         // Corner 2
@@ -604,20 +621,14 @@ void DrawBlockOutline(const Vec3& blockPos, const Mat4& matView, const Mat4& mat
     };
 
     // Project all corners to screen space
-    std::vector<Vec2> projectedCorners;
-    projectedCorners.reserve(8);
-    for (const auto& corner : corners) {
-        Vec2 screenPoint;
-        if (ProjectToScreen(corner, matView, matProj, screenPoint)) {
-            projectedCorners.push_back(screenPoint);
-        } else {
-            // If projection fails (e.g., behind camera), push an invalid point
-            projectedCorners.emplace_back(Vec2(-1.0f, -1.0f));
-        }
+    Vec2 projectedCorners[8];
+    for (int i = 0; i < 8; i++) {
+        // If projection fails (e.g., behind camera), store an invalid point
+        if (!ProjectToScreen(corners[i], matView, matProj, projectedCorners[i])) projectedCorners[i] = Vec2(-1.0f, -1.0f);
     }
 
     // 12 edges of the cube by specifying pairs of corner indices
-    std::vector<std::pair<int, int>> edges = {
+    static const std::pair<int, int> edges[12] = {
         {0, 1}, {1, 2}, {2, 3}, {3, 0}, // Bottom edges
         {4, 5}, {5, 6}, {6, 7}, {7, 4}, // Top edges
         {0, 4}, {1, 5}, {2, 6}, {3, 7}  // Side edges
@@ -640,8 +651,124 @@ void DrawBlockOutline(const Vec3& blockPos, const Mat4& matView, const Mat4& mat
     }
 }
 
-// Main Rendering Function
-void Render() {
+// Re-cull once the view has turned this far from the direction the chunks were culled with
+const float RECULL_ANGLE = 15.0f * PI / 180.0f;
+
+// Conservative sphere vs cone test, used to skip chunks that are outside the view cone
+bool SphereInCone(const Vec3& apex, const Vec3& dir, float coneAngle, const Vec3& centre, float radius) {
+    Vec3 v = centre - apex;
+    float dist = sqrtf(v.dot(v));
+    if (dist <= radius) return true;
+
+    float spread = coneAngle + asinf(radius / dist);
+    if (spread >= PI) return true;
+    return v.dot(dir) / dist >= cosf(spread);
+}
+
+// Build visibleFaces from every exposed face in chunks that can be seen from the camera's current chunk cell
+void GatherVisibleFaces(const Vec3& cullDir, float coneAngle, int cellX, int cellY, int cellZ) {
+    visibleFaces.Reset();
+    sortKeys.Reset();
+    depthSorter.Reset();
+
+    Vec3 viewDir = renderCamera.lookDir.normalize();
+
+    // Chunks are tested against a cone from the camera, widened by the rotation threshold and by how far the camera can move before the cell changes
+    // (the chunk dimensions are fixed before the simulation thread starts, so reading them here is safe)
+    float cellReach = sqrtf(float(world.chunkSize * world.chunkSize * 2 + world.chunkHeight * world.chunkHeight));
+
+    for (size_t c = 0; c < renderSnapshot.meshes.size(); c++) {
+        if (!renderSnapshot.meshes[c]) continue; // New chunk whose first mesh is still being built
+        const ChunkMesh& mesh = *renderSnapshot.meshes[c];
+        uint32_t runBegin = static_cast<uint32_t>(sortKeys.size());
+
+        if (!SphereInCone(renderCamera.pos, cullDir, coneAngle, mesh.centre, mesh.radius + cellReach)) continue;
+
+        // Which side of the chunk the camera's cell is on along each axis. A face direction pointing away from the whole cell is
+        // back-facing from anywhere the camera can be before the next re-cull, so its bucket is skipped outright
+        int side[3] = {
+            cellX - FloorDiv(static_cast<int>(mesh.offset.x), world.chunkSize),
+            cellY - FloorDiv(static_cast<int>(mesh.offset.y), world.chunkHeight),
+            cellZ - FloorDiv(static_cast<int>(mesh.offset.z), world.chunkSize)
+        };
+
+        for (int direction = 0; direction < FACE_COUNT; direction++) {
+            const int* n = FACE_NORMALS[direction];
+            if (n[0] * side[0] < 0 || n[1] * side[1] < 0 || n[2] * side[2] < 0) continue;
+
+            for (uint32_t f = mesh.bucketStart[direction]; f < mesh.bucketStart[direction + 1]; f++) {
+                // Calculate depth (average distance to camera along lookDir)
+                Vec3 center = FaceCentre(mesh, f);
+                float depth = (center - renderCamera.pos).dot(viewDir);
+
+                // Store the packed face and its depth key
+                PackedFace packed;
+                packed.chunk = static_cast<uint32_t>(c);
+                packed.face = f;
+
+                sortKeys.push_back({ DepthSortKey(depth), static_cast<uint32_t>(visibleFaces.size()) });
+                visibleFaces.push_back(packed);
+            }
+        }
+
+        // Each chunk's keys form one run for DepthSortMode::PerChunkMerge
+        uint32_t runEnd = static_cast<uint32_t>(sortKeys.size());
+        if (depthSorter.mode == DepthSortMode::PerChunkMerge && runEnd > runBegin) depthSorter.runs.push_back({ runBegin, runEnd });
+    }
+
+    // Sort faces by depth (Painter's Algorithm: far to near) - only the 8 byte keys move
+    depthSorter.Sort(sortKeys);
+}
+
+// Recompute the depth keys of last frame's list in its sorted order, then fix the order up - it is nearly sorted already
+void RefreshSortKeys() {
+    Vec3 viewDir = renderCamera.lookDir.normalize();
+
+    for (SortKey& sortKey : sortKeys) {
+        const PackedFace& packed = visibleFaces[sortKey.index];
+        Vec3 center = FaceCentre(*renderSnapshot.meshes[packed.chunk], packed.face);
+        sortKey.key = DepthSortKey((center - renderCamera.pos).dot(viewDir));
+    }
+
+    // Fall back to a full radix sort if the order changed too much (runs are stale, so sort globally)
+    if (!InsertionSortKeys(sortKeys.items.data(), sortKeys.size(), sortKeys.size() * 4)) {
+        depthSorter.Reset();
+        depthSorter.Sort(sortKeys);
+    }
+}
+
+// Camera for this frame, interpolated between the last two simulation ticks
+CameraState InterpolateCamera(const WorldSnapshot& snapshot) {
+    if (headless) return snapshot.camera;
+
+    float alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.tickTime).count() / SIM_TICK_SECONDS;
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+
+    const CameraState& a = snapshot.previousCamera;
+    const CameraState& b = snapshot.camera;
+    CameraState out;
+    out.pos = a.pos + (b.pos - a.pos) * alpha;
+    out.lookDir = (a.lookDir + (b.lookDir - a.lookDir) * alpha).normalize();
+    out.bobbingOffsetY = a.bobbingOffsetY + (b.bobbingOffsetY - a.bobbingOffsetY) * alpha;
+    return out;
+}
+
+// Main Rendering Function - returns false when nothing changed and the last frame was left on screen
+bool Render() {
+    snapshots.Read(renderSnapshot);
+    renderCamera = InterpolateCamera(renderSnapshot);
+
+    // Re-present the previous frame outright if nothing moved and the world was not edited
+    if (coherence.presented && !coherence.forceRedraw &&
+        coherence.meshVersion == renderSnapshot.meshVersion &&
+        coherence.presentedWireframe == wireframeMode &&
+        coherence.presentedPos.x == renderCamera.pos.x && coherence.presentedPos.y == renderCamera.pos.y && coherence.presentedPos.z == renderCamera.pos.z &&
+        coherence.presentedLookDir.x == renderCamera.lookDir.x && coherence.presentedLookDir.y == renderCamera.lookDir.y && coherence.presentedLookDir.z == renderCamera.lookDir.z &&
+        renderCamera.bobbingOffsetY == 0.0f) {
+        return false;
+    }
+
     float fNear = 0.1f;
     float fFar = 1000.0f;
     float fFov = 80.0f;
@@ -657,148 +784,143 @@ void Render() {
     matProj.m[3][3] = 0.0f;
 
     // Adjusted Camera Position with Bobbing Offset for Rendering
-    Vec3 renderPos = camera.pos;
-    renderPos.y += camera.bobbingOffsetY;
+    Vec3 renderPos = renderCamera.pos;
+    renderPos.y += renderCamera.bobbingOffsetY;
 
     // Camera matrix
     Vec3 up = {0, 1, 0};
-    Vec3 target = renderPos + camera.lookDir;
+    Vec3 target = renderPos + renderCamera.lookDir;
     Mat4 matCamera = MatrixPointAt(renderPos, target, up);
 
     // View matrix (inverse of camera matrix)
     Mat4 matView = MatrixQuickInverse(matCamera);
 
     // Clipping plane setup
-    Vec3 nearPlanePos = {0, 0, fNear};
-    Vec3 nearPlaneNormal = {0, 0, 1};
-
-    // Collect all visible triangles globally
-    std::vector<SortedTriangle> visibleTriangles;
-
-    for (auto& chunk : world.chunks) {
-        for (auto& block : chunk.blocks) {
-            if (block.type == BlockType::Air) continue;
-
-            Mat4 matTrans = MatrixMakeTranslation(block.position.x, block.position.y, block.position.z);
-            Mat4 matWorld = matTrans;
-
-            for (auto& face : meshCube.faces) {
-                Vec3 neighborPos = block.position + face.normal;
-                int nx = static_cast<int>(floor(neighborPos.x));
-                int ny = static_cast<int>(floor(neighborPos.y));
-                int nz = static_cast<int>(floor(neighborPos.z));
-
-                // Check for a neighboring block, and skip the face if it exists
-                if (world.IsBlockAtPosition(nx, ny, nz)) continue;
-
-                for (int i = 0; i < 2; i++) {
-                    Triangle tri = face.tris[i];
-                    Triangle triTransformed;
-
-                    // Transform vertices
-                    for (int j = 0; j < 3; ++j) {
-                        triTransformed.v[j].pos = MultiplyMatrixVector(tri.v[j].pos, matWorld);
-                        triTransformed.v[j].tex = tri.v[j].tex;
-                    }
-
-                    // Calculate depth (average distance to camera along lookDir)
-                    Vec3 center = (triTransformed.v[0].pos + triTransformed.v[1].pos + triTransformed.v[2].pos) * (1.0f / 3.0f);
-                    float depth = (center - camera.pos).dot(camera.lookDir.normalize());
-
-                    // Store the triangle with its depth, block type, and face normal
-                    SortedTriangle sortedTri;
-                    sortedTri.tri = triTransformed;
-                    sortedTri.depth = depth;
-                    sortedTri.type = block.type;
-                    sortedTri.faceNormal = face.normal;
-                    visibleTriangles.push_back(sortedTri);
-                }
-            }
-        }
+    ViewClipper clipper;
+    clipper.Setup(fAspectRatio * fFovRad, fFovRad, fNear);
+
+    // Only re-cull when the world changed, the camera entered another chunk cell or the view turned past the threshold
+    int cellX = FloorDiv(static_cast<int>(floor(renderCamera.pos.x)), world.chunkSize);
+    int cellY = FloorDiv(static_cast<int>(floor(renderCamera.pos.y)), world.chunkHeight);
+    int cellZ = FloorDiv(static_cast<int>(floor(renderCamera.pos.z)), world.chunkSize);
+    Vec3 viewDir = renderCamera.lookDir.normalize();
+
+    bool recull = !coherence.gathered || coherence.meshVersion != renderSnapshot.meshVersion ||
+                  cellX != coherence.cellX || cellY != coherence.cellY || cellZ != coherence.cellZ ||
+                  viewDir.dot(coherence.cullDir) < cosf(RECULL_ANGLE);
+
+    if (recull) {
+        // Half-angle of the view frustum's corner rays, plus the rotation allowed before the next re-cull
+        float tanHalfV = tanf(fFov * 0.5f / 180.0f * PI);
+        float tanHalfH = tanHalfV / fAspectRatio;
+        float coneAngle = atanf(sqrtf(tanHalfV * tanHalfV + tanHalfH * tanHalfH)) + RECULL_ANGLE;
+
+        GatherVisibleFaces(viewDir, coneAngle, cellX, cellY, cellZ);
+
+        coherence.gathered = true;
+        coherence.meshVersion = renderSnapshot.meshVersion;
+        coherence.cellX = cellX;
+        coherence.cellY = cellY;
+        coherence.cellZ = cellZ;
+        coherence.cullDir = viewDir;
+    } else {
+        RefreshSortKeys();
     }
 
-    // Sort triangles by depth (Painter's Algorithm: far to near)
-    std::sort(visibleTriangles.begin(), visibleTriangles.end(), [](const SortedTriangle& a, const SortedTriangle& b) {
-        return a.depth > b.depth; // Sort from farthest to nearest
-    });
+    coherence.presented = true;
+    coherence.presentedPos = renderCamera.pos;
+    coherence.presentedLookDir = renderCamera.lookDir;
+    coherence.presentedWireframe = wireframeMode;
+    coherence.forceRedraw = false;
 
     // Clear the screen
+    BeginScene();
     ClearScreen();
 
     // Conditional Rendering: Textured or Wireframe
     if (!wireframeMode) {
         // Textured Rendering Mode
-        for (const auto& sortedTri : visibleTriangles) {
-            Triangle triProjected, triTransformed, triViewed;
-            Triangle clipped[2];
-
-            triTransformed = sortedTri.tri;
-
-            Vec3 normal, line1, line2;
-
-            line1 = triTransformed.v[1].pos - triTransformed.v[0].pos;
-            line2 = triTransformed.v[2].pos - triTransformed.v[0].pos;
-
-            normal = line1.cross(line2).normalize();
+        for (const SortKey& sortKey : sortKeys) {
+            const PackedFace& packed = visibleFaces[sortKey.index];
+            const ChunkMesh& mesh = *renderSnapshot.meshes[packed.chunk];
+            const MeshFace& face = mesh.faces[packed.face];
 
-            Vec3 cameraRay = triTransformed.v[0].pos - camera.pos;
+            Vertex quad[4];
+            for (int j = 0; j < 4; ++j) quad[j] = UnpackVertex(mesh, packed.face, j);
 
-            if (normal.dot(cameraRay) >= 0.0f) continue;
+            // Skip faces pointing away from the camera
+            const int* n = FACE_NORMALS[face.face];
+            Vec3 cameraRay = quad[0].pos - renderCamera.pos;
+            if (cameraRay.x * n[0] + cameraRay.y * n[1] + cameraRay.z * n[2] >= 0.0f) continue;
 
             // Transform to view space
-            Mat4 matViewCopy = matView;
-            for (int j = 0; j < 3; ++j) {
-                triViewed.v[j].pos = MultiplyMatrixVector(triTransformed.v[j].pos, matViewCopy);
-                triViewed.v[j].tex = triTransformed.v[j].tex;
+            uint8_t viewCodes[4], guardCodes[4];
+            uint8_t outsideAll = 0xFF, guardAny = 0;
+            for (int j = 0; j < 4; ++j) {
+                quad[j].pos = MultiplyMatrixVector(quad[j].pos, matView);
+                viewCodes[j] = clipper.ViewOutcode(quad[j].pos);
+                guardCodes[j] = clipper.GuardOutcode(quad[j].pos);
+                outsideAll &= viewCodes[j];
+                guardAny |= guardCodes[j];
             }
 
-            int nClippedTriangles = TriangleClipAgainstPlane(nearPlanePos, nearPlaneNormal, triViewed, clipped[0], clipped[1]);
+            // Every corner beyond the same side of the view - nothing of it can be on screen
+            if (outsideAll) continue;
 
-            for (int n = 0; n < nClippedTriangles; n++) {
-                // Project the triangle
-                Triangle triProjectedTemp;
-                for (int j = 0; j < 3; ++j) {
-                    triProjectedTemp.v[j].pos = MultiplyMatrixVector(clipped[n].v[j].pos, matProj);
-                    triProjectedTemp.v[j].tex = clipped[n].v[j].tex;
-                }
+            if (!guardAny) {
+                for (int j = 0; j < 4; ++j) quad[j] = ProjectVertex(quad[j], matProj);
+                DrawQuad(quad, face.tile);
+                continue;
+            }
 
-                // Scale into view
-                for (int j = 0; j < 3; ++j) {
-                    triProjectedTemp.v[j].pos.x = (triProjectedTemp.v[j].pos.x + 1.0f) * 0.5f * SCREEN_WIDTH;
-                    triProjectedTemp.v[j].pos.y = (1.0f - (triProjectedTemp.v[j].pos.y + 1.0f) * 0.5f) * SCREEN_HEIGHT;
+            // Crosses the near plane or the guard band - clip the two triangles separately, each against just the planes it crosses
+            for (int t = 0; t < 2; t++) {
+                const uint8_t* corners = TRI_CORNERS[t];
+                if (viewCodes[corners[0]] & viewCodes[corners[1]] & viewCodes[corners[2]]) continue;
+
+                Triangle triViewed;
+                Triangle clipped[MAX_CLIPPED_TRIANGLES];
+                for (int j = 0; j < 3; ++j) triViewed.v[j] = quad[corners[j]];
+
+                uint8_t mask = guardCodes[corners[0]] | guardCodes[corners[1]] | guardCodes[corners[2]];
+                int nClippedTriangles = mask ? clipper.Clip(triViewed, mask, clipped) : 1;
+                if (!mask) clipped[0] = triViewed;
+                for (int c = 0; c < nClippedTriangles; c++) {
+                    Vertex projected[4];
+                    for (int j = 0; j < 3; ++j) projected[j] = ProjectVertex(clipped[c].v[j], matProj);
+                    projected[3] = projected[2];
+                    DrawQuad(projected, face.tile);
                 }
-
-                DrawTriangle(triProjectedTemp, sortedTri.type, sortedTri.faceNormal);
             }
         }
+        FlushBatch();
     }
     else {
         // Wireframe Rendering Mode
-        for (const auto& sortedTri : visibleTriangles) {
-            Triangle triProjected, triTransformed, triViewed;
-            Triangle clipped[2];
-
-            triTransformed = sortedTri.tri;
+        for (size_t k = 0; k < sortKeys.size() * 2; k++) {
+            const PackedFace& packed = visibleFaces[sortKeys[k / 2].index];
+            Triangle triTransformed, triViewed;
+            Triangle clipped[MAX_CLIPPED_TRIANGLES];
 
-            Vec3 normal, line1, line2;
+            triTransformed = UnpackTriangle(packed, static_cast<int>(k % 2));
 
-            line1 = triTransformed.v[1].pos - triTransformed.v[0].pos;
-            line2 = triTransformed.v[2].pos - triTransformed.v[0].pos;
-
-            normal = line1.cross(line2).normalize();
-
-            Vec3 cameraRay = triTransformed.v[0].pos - camera.pos;
-
-            if (normal.dot(cameraRay) >= 0.0f) continue;
+            // Skip faces pointing away from the camera - faces are axis-aligned, so the normal comes straight from the face direction
+            const int* n = FACE_NORMALS[renderSnapshot.meshes[packed.chunk]->faces[packed.face].face];
+            Vec3 cameraRay = triTransformed.v[0].pos - renderCamera.pos;
+            if (cameraRay.x * n[0] + cameraRay.y * n[1] + cameraRay.z * n[2] >= 0.0f) continue;
 
             // Transform to view space
-            Mat4 matViewCopy = matView;
+            uint8_t outsideAll = 0xFF, guardAny = 0;
             for (int j = 0; j < 3; ++j) {
-                triViewed.v[j].pos = MultiplyMatrixVector(triTransformed.v[j].pos, matViewCopy);
+                triViewed.v[j].pos = MultiplyMatrixVector(triTransformed.v[j].pos, matView);
                 triViewed.v[j].tex = triTransformed.v[j].tex;
+                outsideAll &= clipper.ViewOutcode(triViewed.v[j].pos);
+                guardAny |= clipper.GuardOutcode(triViewed.v[j].pos);
             }
+            if (outsideAll) continue;
 
-            int nClippedTriangles = TriangleClipAgainstPlane(nearPlanePos, nearPlaneNormal, triViewed, clipped[0], clipped[1]);
+            int nClippedTriangles = guardAny ? clipper.Clip(triViewed, guardAny, clipped) : 1;
+            if (!guardAny) clipped[0] = triViewed;
 
             for (int n = 0; n < nClippedTriangles; n++) {
                 // Project the triangle
@@ -810,8 +932,8 @@ void Render() {
 
                 // Scale into view
                 for (int j = 0; j < 3; ++j) {
-                    triProjectedTemp.v[j].pos.x = (triProjectedTemp.v[j].pos.x + 1.0f) * 0.5f * SCREEN_WIDTH;
-                    triProjectedTemp.v[j].pos.y = (1.0f - (triProjectedTemp.v[j].pos.y + 1.0f) * 0.5f) * SCREEN_HEIGHT;
+                    triProjectedTemp.v[j].pos.x = (triProjectedTemp.v[j].pos.x + 1.0f) * 0.5f * renderWidth;
+                    triProjectedTemp.v[j].pos.y = (1.0f - (triProjectedTemp.v[j].pos.y + 1.0f) * 0.5f) * renderHeight;
                 }
 
                 // Draw the wireframe triangle
@@ -821,29 +943,463 @@ void Render() {
     }
 
     // Draws the outline around the selected block - this is currently disabled as there is an alignment issue
-    if (hasSelectedBlock) {
-        // DrawBlockOutline(selectedBlockPosition, matView, matProj);
+    if (renderSnapshot.hasSelectedBlock) {
+        // DrawBlockOutline(renderSnapshot.selectedBlockPosition, matView, matProj);
     }
 
+    EndScene();
     DrawCrosshair();
 
     SDL_RenderPresent(renderer);
+    return true;
 }
 
-// Main loop Function
-void MainLoop() {
-    static Uint32 lastTime = SDL_GetTicks();
-    Uint32 currentTime = SDL_GetTicks();
-    float deltaTime = (currentTime - lastTime) / 1000.0f;
-    lastTime = currentTime;
+// Prints how many of the recent frames allocated inside Render() - should be zero once the scratch buffers have grown
+void ReportRenderAllocations(std::size_t allocations) {
+    static int frames = 0;
+    static int allocatingFrames = 0;
+    static std::size_t maxAllocations = 0;
+
+    frames++;
+    if (allocations > 0) allocatingFrames++;
+    if (allocations > maxAllocations) maxAllocations = allocations;
+
+    if (frames == 300) {
+        printf("Render allocations: %d of the last %d frames allocated (max %zu per frame)\n", allocatingFrames, frames, maxAllocations);
+        frames = 0;
+        allocatingFrames = 0;
+        maxAllocations = 0;
+    }
+}
+
+// Take the input gathered since the last tick
+void TakeInput() {
+    inputQueue.Take(simInput);
+    if (simInput.hasEvents) {
+        inputSequence++;
+        inputTime = simInput.oldestEvent;
+    }
+}
+
+// Build every mesh on the calling thread - only used before the threads start
+void BuildAllMeshesNow() {
+    for (Chunk& chunk : world.chunks) {
+        chunk.mesh = BuildChunkMesh(*CaptureChunkVolume(world, chunk));
+        chunk.meshDirty = false;
+    }
+    meshVersion++;
+}
 
+// Rebuild just the edited chunks on the calling thread - replay playback has no mesh workers
+void BuildDirtyMeshesNow() {
+    bool changed = false;
+    for (Chunk& chunk : world.chunks) {
+        if (!chunk.meshDirty) continue;
+        chunk.mesh = BuildChunkMesh(*CaptureChunkVolume(world, chunk));
+        chunk.meshDirty = false;
+        changed = true;
+    }
+    if (changed) meshVersion++;
+}
+
+// Lower runs sooner - nearest chunks first, and chunks in front of the camera before those behind it
+float MeshPriority(const Chunk& chunk) {
+    Vec3 centre = chunk.offset + Vec3(chunk.sizeX * 0.5f, chunk.sizeY * 0.5f, chunk.sizeZ * 0.5f);
+    Vec3 toChunk = centre - camera.pos;
+    float distance = sqrtf(toChunk.dot(toChunk));
+
+    const float behindPenalty = 10000.0f;
+    bool inView = distance < chunk.sizeY || toChunk.dot(camera.lookDir) >= distance * 0.5f; // Within 60 degrees of the view direction
+    return inView ? distance : distance + behindPenalty;
+}
+
+// Hand the chunks touched by edits to the mesh workers - each job gets its own copy of the blocks it needs
+void ScheduleDirtyMeshes() {
+    for (size_t i = 0; i < world.chunks.size(); i++) {
+        Chunk& chunk = world.chunks[i];
+        if (!chunk.meshDirty) continue;
+
+        std::shared_ptr<ChunkVolume> volume = CaptureChunkVolume(world, chunk);
+        uint32_t sequence = ++chunk.meshRequested;
+        chunk.meshDirty = false;
+
+        meshJobs->Submit(MeshPriority(chunk), [i, sequence, volume]() {
+            std::shared_ptr<const ChunkMesh> mesh = BuildChunkMesh(*volume);
+            std::lock_guard<std::mutex> lock(finishedMeshMutex);
+            finishedMeshes.push_back({ i, sequence, mesh });
+        });
+    }
+}
+
+// Swap in meshes the workers have finished. Chunks still waiting keep their stale mesh, and results older than the current mesh are dropped
+void ApplyFinishedMeshes() {
+    static std::vector<FinishedMesh> done;
+    {
+        std::lock_guard<std::mutex> lock(finishedMeshMutex);
+        done.swap(finishedMeshes);
+    }
+
+    bool changed = false;
+    for (FinishedMesh& finished : done) {
+        Chunk& chunk = world.chunks[finished.chunk];
+        if (finished.sequence <= chunk.meshApplied) continue;
+        chunk.mesh = std::move(finished.mesh);
+        chunk.meshApplied = finished.sequence;
+        changed = true;
+    }
+    done.clear();
+
+    if (changed) meshVersion++;
+}
+
+// Fill the back snapshot with this tick's state and hand it to the renderer
+void PublishSnapshot() {
+    WorldSnapshot& back = snapshots.Back();
+
+    CameraState current;
+    current.pos = camera.pos;
+    current.lookDir = camera.lookDir;
+    current.bobbingOffsetY = camera.bobbingOffsetY;
+
+    back.previousCamera = publishedCamera;
+    back.camera = current;
+    back.tickTime = std::chrono::steady_clock::now();
+    publishedCamera = current;
+
+    back.hasSelectedBlock = hasSelectedBlock;
+    back.selectedBlockPosition = selectedBlockPosition;
+    back.inputSequence = inputSequence;
+    back.inputTime = inputTime;
+
+    back.meshVersion = meshVersion;
+    back.meshes.resize(world.chunks.size());
+    for (size_t i = 0; i < world.chunks.size(); i++) back.meshes[i] = world.chunks[i].mesh;
+
+    snapshots.Publish();
+}
+
+// Fixed-rate simulation loop - owns camera physics and world edits
+void SimulationLoop() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(SIM_TICK_SECONDS));
+    Clock::time_point nextTick = Clock::now();
+
+    while (simRunning.load()) {
+        TakeInput();
+        if (networked) PollServer();
+        tickEdits.clear();
+        Update(SIM_TICK_SECONDS);
+        if (networked) server.Flush();
+        replayWriter.WriteTick(simInput, tickEdits);
+        if (networked) {
+            // The server's world doesn't tick, so a copy of it mustn't either
+            world.blockUpdates.clear();
+            world.fluidUpdates.clear();
+        } else {
+            blockTicker.Update(camera.pos);
+            fluids.Update(meshJobs.get());
+        }
+        lightEngine.Update(LIGHT_BUDGET_MS);
+        ScheduleDirtyMeshes();
+        ApplyFinishedMeshes();
+        PublishSnapshot();
+
+        // Don't try to catch up after a long stall (e.g. the tab was in the background)
+        nextTick += tick;
+        Clock::time_point now = Clock::now();
+        if (now - nextTick > tick * 5) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+// Main loop Function - the simulation runs on its own thread, so this only gathers input and renders
+void MainLoop() {
     HandleInput();
-    Update(deltaTime);
-    Render();
+
+    std::size_t allocationsBefore = GetHeapAllocationCount();
+    InputClock::time_point frameStart = InputClock::now();
+    bool rendered = Render();
+    if (rendered && sceneTarget) {
+        float frameMs = std::chrono::duration<float, std::milli>(InputClock::now() - frameStart).count();
+        if (resolutionScaler.Update(frameMs)) coherence.forceRedraw = true;
+    }
+#ifdef COUNT_ALLOCATIONS
+    ReportRenderAllocations(GetHeapAllocationCount() - allocationsBefore);
+#else
+    (void)allocationsBefore;
+#endif
+#ifdef MEASURE_LATENCY
+    if (rendered) latencyStats.Record(renderSnapshot.inputSequence, renderSnapshot.inputTime);
+#endif
+
+#ifndef __EMSCRIPTEN__
+    // Idle natively when the last frame was re-presented (the browser already paces us with requestAnimationFrame)
+    if (!rendered) SDL_Delay(1);
+#else
+    (void)rendered;
+#endif
+}
+
+// Generate the world (unless it came from a server), light it, put the camera in the middle and publish the first snapshot
+void InitialiseWorld() {
+    if (!networked) {
+        world.Initialise();
+        // world.GenerateFlatWorld();
+        world.GeneratePerlinWorld();
+    }
+    blockTicker.Reset(world.seed);
+    fluids.Reset();
+    lightEngine.Rebuild();
+
+    // Calculate center position
+    float centerX = (world.worldSize * world.chunkSize) / 2.0f;
+    float centerZ = (world.worldSize * world.chunkSize) / 2.0f;
+    camera.pos = {centerX, 20.0f, centerZ};
+    camera.yaw = 0.0f;
+    camera.pitch = 0.0f;
+    camera.lookDir = {0.0f, 0.0f, 1.0f};
+    camera.verticalVelocity = 0.0f;
+    camera.isOnGround = false;
+
+    BuildAllMeshesNow();
+    publishedCamera.pos = camera.pos;
+    publishedCamera.lookDir = camera.lookDir;
+    PublishSnapshot();
+}
+
+// Hash of everything a recording has to reproduce - the blocks, the settled light and the camera
+uint64_t HashWorldState() {
+    while (!lightEngine.Update(1000.0f)) {}
+
+    UnorderedHash blocks;
+    for (const Chunk& chunk : world.chunks) {
+        int ox = static_cast<int>(chunk.offset.x), oy = static_cast<int>(chunk.offset.y), oz = static_cast<int>(chunk.offset.z);
+        for (int y = 0; y < chunk.sizeY; y++) {
+            for (int z = 0; z < chunk.sizeZ; z++) {
+                for (int x = 0; x < chunk.sizeX; x++) {
+                    BlockType type = chunk.BlockAt(x, y, z);
+                    uint64_t state = static_cast<uint64_t>(type) | static_cast<uint64_t>(chunk.FluidAt(chunk.VoxelIndex(x, y, z))) << 8;
+                    if (type != BlockType::Air) blocks.Add(MixHash64(PackCoords(ox + x, oy + y, oz + z)) ^ state);
+                }
+            }
+        }
+    }
+
+    uint64_t hash = MixHash64(blocks.sum);
+    for (const Chunk& chunk : world.chunks) {
+        for (uint8_t level : chunk.light) hash = MixHash64(hash ^ level);
+    }
+
+    float cameraState[5] = { camera.pos.x, camera.pos.y, camera.pos.z, camera.yaw, camera.pitch };
+    for (float value : cameraState) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = MixHash64(hash ^ bits);
+    }
+    return hash;
+}
+
+// Software renderer drawing into an offscreen surface, for running with no window. Returns the surface, or null on failure
+SDL_Surface* StartHeadless() {
+    SDL_Init(0);
+    IMG_Init(IMG_INIT_PNG);
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    if (!renderer) {
+        printf("Failed to create a software renderer: %s\n", SDL_GetError());
+        return nullptr;
+    }
+    if (!atlas.Load(renderer, "assets/texture_atlas.png")) {
+        printf("Failed to load texture atlas: %s\n", IMG_GetError());
+        return nullptr;
+    }
+    InitQuadIndices();
+    headless = true;
+    return target;
+}
+
+void StopHeadless(SDL_Surface* target) {
+    atlas.Destroy();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+    IMG_Quit();
+    SDL_Quit();
+}
+
+// Play a recording back on this thread as fast as it will go - every tick is simulated, meshed and drawn into an offscreen surface.
+// Returns the process exit code: 0 when the world ends up exactly as it was recorded
+int RunReplay(const char* path) {
+    ReplayReader reader;
+    if (!reader.Open(path)) {
+        printf("Failed to open replay %s\n", path);
+        return 1;
+    }
+
+    SDL_Surface* target = StartHeadless();
+    if (!target) return 1;
+
+    world.SetSeed(reader.seed);
+    InitialiseWorld();
+
+    using Clock = std::chrono::steady_clock;
+    ReplayTiming updateTiming, lightTiming, meshTiming, renderTiming;
+    std::vector<ReplayEdit> recordedEdits;
+    uint32_t ticks = 0;
+    int divergedTick = -1;
+    Clock::time_point start = Clock::now();
+
+    while (reader.NextTick(simInput, recordedEdits)) {
+        Clock::time_point t0 = Clock::now();
+        tickEdits.clear();
+        Update(SIM_TICK_SECONDS);
+        blockTicker.Update(camera.pos);
+        fluids.Update(nullptr);
+        Clock::time_point t1 = Clock::now();
+        lightEngine.Update(LIGHT_BUDGET_MS);
+        Clock::time_point t2 = Clock::now();
+        BuildDirtyMeshesNow();
+        PublishSnapshot();
+        Clock::time_point t3 = Clock::now();
+        Render();
+        Clock::time_point t4 = Clock::now();
+
+        updateTiming.Add(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        lightTiming.Add(std::chrono::duration<double, std::milli>(t2 - t1).count());
+        meshTiming.Add(std::chrono::duration<double, std::milli>(t3 - t2).count());
+        renderTiming.Add(std::chrono::duration<double, std::milli>(t4 - t3).count());
+
+        if (divergedTick < 0 && tickEdits != recordedEdits) divergedTick = static_cast<int>(ticks);
+        ticks++;
+    }
+    double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    uint64_t hash = HashWorldState();
+    bool complete = reader.Finished() && reader.tickCount == ticks;
+
+    printf("Replayed %u ticks (%.1f s of play) in %.1f ms - %.0f ticks per second\n", ticks, ticks * SIM_TICK_SECONDS, totalMs, ticks / (totalMs / 1000.0));
+    updateTiming.Print("update");
+    lightTiming.Print("light");
+    meshTiming.Print("mesh");
+    renderTiming.Print("render");
+    if (divergedTick >= 0) printf("Edits first differed from the recording at tick %d\n", divergedTick);
+    if (!complete) printf("Replay ended early - the file is truncated or damaged after tick %u\n", ticks);
+    printf("Block storage: %zu bytes across %zu chunks\n", world.BlockMemoryUsage(), world.chunks.size());
+    printf("World hash %016llx, recorded %016llx - %s\n", static_cast<unsigned long long>(hash), static_cast<unsigned long long>(reader.worldHash),
+           complete && hash == reader.worldHash ? "match" : "MISMATCH");
+
+    StopHeadless(target);
+    return complete && hash == reader.worldHash && divergedTick < 0 ? 0 : 1;
+}
+
+// Reference views for --golden, drawn from a world generated with a fixed seed. Between them they cover open terrain, the near plane
+// (looking straight down from just above the ground), the guard band (edges of the world close up), sky only, and the wireframe path
+struct GoldenPose {
+    const char* name;
+    Vec3 pos;
+    float yaw, pitch;
+    bool wireframe;
+};
+
+const unsigned int GOLDEN_SEED = 1234;
+const GoldenPose GOLDEN_POSES[] = {
+    { "overview",  { 24.0f, 24.0f, -10.0f }, 0.0f,   -35.0f, false },
+    { "horizon",   { 2.0f,  13.0f, 2.0f },   45.0f,  -5.0f,  false },
+    { "down",      { 24.0f, 12.5f, 24.0f },  0.0f,   -89.0f, false },
+    { "corner",    { -1.5f, 6.0f,  -1.5f },  30.0f,  -20.0f, false },
+    { "sky",       { 24.0f, 14.0f, 24.0f },  120.0f, 70.0f,  false },
+    { "wireframe", { 24.0f, 24.0f, -10.0f }, 0.0f,   -35.0f, true },
+};
+
+// Copy the offscreen surface out as RGB
+void ReadSurface(SDL_Surface* surface, RgbImage& image) {
+    image.Resize(surface->w, surface->h);
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y++) {
+        const uint8_t* row = static_cast<const uint8_t*>(surface->pixels) + y * surface->pitch;
+        for (int x = 0; x < surface->w; x++) {
+            uint8_t* out = image.Pixel(x, y);
+            out[0] = row[x * 4];
+            out[1] = row[x * 4 + 1];
+            out[2] = row[x * 4 + 2];
+        }
+    }
+    SDL_UnlockSurface(surface);
+}
+
+// Render each golden pose headlessly and save it to dir as <name>.ppm, plus a PNG to look at. Returns the process exit code
+int RunGolden(const char* dir) {
+    SDL_Surface* target = StartHeadless();
+    if (!target) return 1;
+
+    world.SetSeed(GOLDEN_SEED);
+    InitialiseWorld();
+
+    RgbImage image;
+    int failures = 0;
+    for (const GoldenPose& pose : GOLDEN_POSES) {
+        camera.pos = pose.pos;
+        camera.yaw = pose.yaw;
+        camera.pitch = pose.pitch;
+        camera.bobbingOffsetY = 0.0f;
+        ApplyMouseLook(0, 0);
+        wireframeMode = pose.wireframe;
+        PublishSnapshot();
+        coherence.forceRedraw = true;
+        Render();
+
+        std::string path = std::string(dir) + "/" + pose.name;
+        ReadSurface(target, image);
+        if (!WritePPM((path + ".ppm").c_str(), image)) {
+            printf("Failed to write %s.ppm\n", path.c_str());
+            failures++;
+            continue;
+        }
+        IMG_SavePNG(target, (path + ".png").c_str());
+        printf("Wrote %s.ppm - %zu faces in view\n", path.c_str(), sortKeys.size());
+    }
+
+    StopHeadless(target);
+    return failures == 0 ? 0 : 1;
+}
+
+int Usage(const char* program) {
+    printf("Usage: %s [--record file | --replay file | --connect host[:port] | --golden dir] [--frame-target ms] [--min-scale s] [--max-scale s] [--sort-mode global|merge (slower, for checking)]\n", program);
+    return 2;
 }
 
 int main(int argc, char* argv[])
 {
+    // --record <file> saves the session, --replay <file> plays one back headlessly and checks it, --connect <host[:port]> joins a world server.
+    // --golden <dir> renders the reference poses headlessly into dir for comparison with tools/ImageDiff.
+    // --frame-target <ms>, --min-scale and --max-scale tune the dynamic render resolution.
+    // --sort-mode merge depth sorts each chunk's faces on their own and merges them, instead of one sort over every face (global).
+    // It draws the same order, only slower - it's for checking the sort, not a faster alternative
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* connectAddress = nullptr;
+    const char* goldenDir = nullptr;
+    ResolutionSettings resolution;
+    resolution.targetMs = FRAME_TARGET_MS;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return Usage(argv[0]); // Every option takes a value
+        if (strcmp(argv[i], "--record") == 0) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0) replayPath = argv[++i];
+        else if (strcmp(argv[i], "--connect") == 0) connectAddress = argv[++i];
+        else if (strcmp(argv[i], "--golden") == 0) goldenDir = argv[++i];
+        else if (strcmp(argv[i], "--frame-target") == 0) resolution.targetMs = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--min-scale") == 0) resolution.minScale = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--max-scale") == 0) resolution.maxScale = static_cast<float>(atof(argv[++i]));
+        else if (strcmp(argv[i], "--sort-mode") == 0) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "global") == 0) depthSorter.mode = DepthSortMode::Global;
+            else if (strcmp(mode, "merge") == 0) depthSorter.mode = DepthSortMode::PerChunkMerge;
+            else return Usage(argv[0]);
+        }
+        else return Usage(argv[0]);
+    }
+    if (replayPath) return RunReplay(replayPath);
+    if (goldenDir) return RunGolden(goldenDir);
+
     SDL_Init(SDL_INIT_VIDEO);
 
     // Initialise SDL_image
@@ -852,39 +1408,64 @@ int main(int argc, char* argv[])
     window = SDL_CreateWindow("3D Cube Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 
-    // Load the texture atlas
-    textureAtlas = IMG_LoadTexture(renderer, "assets/texture_atlas.png");
-    if (!textureAtlas) {
+    // Load the texture atlas and build its padded mip chains
+    if (!atlas.Load(renderer, "assets/texture_atlas.png")) {
         printf("Failed to load texture atlas: %s\n", IMG_GetError());
         return 1;
     }
 
-    // Set texture properties
-    SDL_SetTextureBlendMode(textureAtlas, SDL_BLENDMODE_BLEND);
-    SDL_SetTextureScaleMode(textureAtlas, SDL_ScaleModeNearest);
-
-    InitCubeMesh();
+    InitQuadIndices();
+
+    // Full size scene target - lower resolutions use its top left corner, smoothed when stretched back up
+    resolutionScaler.Configure(resolution);
+    sceneTarget = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (sceneTarget) SDL_SetTextureScaleMode(sceneTarget, SDL_ScaleModeLinear);
+    else printf("Render targets unsupported, dynamic resolution disabled: %s\n", SDL_GetError());
+
+    if (connectAddress) {
+        // A recording can't be replayed without the server's edits, so the two don't mix
+        recordPath = nullptr;
+        std::string host = connectAddress;
+        uint16_t port = NET_DEFAULT_PORT;
+        std::size_t colon = host.rfind(':');
+        if (colon != std::string::npos) {
+            port = static_cast<uint16_t>(atoi(host.c_str() + colon + 1));
+            host.resize(colon);
+        }
+        if (!DownloadWorld(host.c_str(), port)) {
+            printf("Failed to join the world server at %s\n", connectAddress);
+            return 1;
+        }
+        printf("Joined %s - %zu sections\n", connectAddress, world.chunks.size());
+    }
 
-    // Initialise world and set variables
-    world.Initialise();
-    // world.GenerateFlatWorld();
-    world.GeneratePerlinWorld();
+    if (recordPath && !replayWriter.Open(recordPath, world.seed)) printf("Failed to open %s for recording\n", recordPath);
 
-    // Calculate center position
-    float centerX = (world.worldSize * world.chunkSize) / 2.0f;
-    float centerZ = (world.worldSize * world.chunkSize) / 2.0f;
-    camera.pos = {centerX, 20.0f, centerZ};
-    camera.yaw = 0.0f;
-    camera.pitch = 0.0f;
-    camera.verticalVelocity = 0.0f;
-    camera.isOnGround = false;
+    // First snapshot is published before the threads split so the renderer always has something to draw
+    InitialiseWorld();
+    meshJobs.reset(new JobSystem(MESH_WORKER_COUNT));
+    simThread = std::thread(SimulationLoop);
 
     SDL_SetRelativeMouseMode(SDL_TRUE);
 
+#ifdef __EMSCRIPTEN__
     emscripten_set_main_loop(MainLoop, 0, 1);
+#else
+    while (running) MainLoop();
+#endif
+
+    simRunning = false;
+    simThread.join();
+    meshJobs.reset();
+
+    if (replayWriter.IsOpen()) {
+        replayWriter.Finish(HashWorldState());
+        printf("Recorded %u ticks to %s\n", replayWriter.TickCount(), recordPath);
+    }
 
     // Clean up
-    SDL_DestroyTexture(textureAtlas);
+    if (sceneTarget) SDL_DestroyTexture(sceneTarget);
+    atlas.Destroy();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     IMG_Quit();
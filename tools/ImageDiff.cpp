@@ -0,0 +1,145 @@
+// ImageDiff.cpp - compares rendered frames against golden references (make golden)
+#include <dirent.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ImageFile.hpp"
+
+// A pixel differs when any channel is off by more than the tolerance, and an image fails when more than maxPercent of its pixels differ.
+// The defaults allow for rounding differences between rasterisers but not for a missing face
+struct DiffSettings {
+    int tolerance = 8;
+    double maxPercent = 0.1;
+    const char* diffDir = nullptr; // Where to write images highlighting the differences, if anywhere
+};
+
+struct DiffResult {
+    long differing = 0;
+    int maxDelta = 0;
+    double psnr = 0.0;
+};
+
+// Differing pixels in red over a faded grey copy of the reference
+void WriteDiffImage(const char* path, const RgbImage& reference, const RgbImage& candidate, int tolerance) {
+    RgbImage out;
+    out.Resize(reference.width, reference.height);
+    for (int y = 0; y < reference.height; y++) {
+        for (int x = 0; x < reference.width; x++) {
+            const uint8_t* a = reference.Pixel(x, y);
+            const uint8_t* b = candidate.Pixel(x, y);
+            uint8_t* o = out.Pixel(x, y);
+            int delta = std::max(std::abs(a[0] - b[0]), std::max(std::abs(a[1] - b[1]), std::abs(a[2] - b[2])));
+            if (delta > tolerance) {
+                o[0] = 255;
+                o[1] = o[2] = 0;
+            } else {
+                o[0] = o[1] = o[2] = static_cast<uint8_t>(64 + (a[0] + a[1] + a[2]) / 6);
+            }
+        }
+    }
+    WritePPM(path, out);
+}
+
+DiffResult Diff(const RgbImage& reference, const RgbImage& candidate, int tolerance) {
+    DiffResult result;
+    double squared = 0.0;
+    for (int y = 0; y < reference.height; y++) {
+        for (int x = 0; x < reference.width; x++) {
+            const uint8_t* a = reference.Pixel(x, y);
+            const uint8_t* b = candidate.Pixel(x, y);
+            int delta = 0;
+            for (int c = 0; c < 3; c++) {
+                int d = std::abs(a[c] - b[c]);
+                delta = std::max(delta, d);
+                squared += d * d;
+            }
+            if (delta > tolerance) result.differing++;
+            result.maxDelta = std::max(result.maxDelta, delta);
+        }
+    }
+    double mse = squared / (static_cast<double>(reference.width) * reference.height * 3);
+    result.psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+    return result;
+}
+
+// Compare one pair of files and print a line about it - true if the candidate passes
+bool CompareFiles(const std::string& referencePath, const std::string& candidatePath, const std::string& name, const DiffSettings& settings) {
+    RgbImage reference, candidate;
+    if (!ReadPPM(referencePath.c_str(), reference)) {
+        printf("%-12s FAIL  can't read %s\n", name.c_str(), referencePath.c_str());
+        return false;
+    }
+    if (!ReadPPM(candidatePath.c_str(), candidate)) {
+        printf("%-12s FAIL  can't read %s\n", name.c_str(), candidatePath.c_str());
+        return false;
+    }
+    if (reference.width != candidate.width || reference.height != candidate.height) {
+        printf("%-12s FAIL  size %dx%d, reference is %dx%d\n", name.c_str(), candidate.width, candidate.height, reference.width, reference.height);
+        return false;
+    }
+
+    DiffResult result = Diff(reference, candidate, settings.tolerance);
+    double percent = 100.0 * result.differing / (static_cast<double>(reference.width) * reference.height);
+    bool pass = percent <= settings.maxPercent;
+    printf("%-12s %s  %ld pixels differ (%.3f%%), max channel delta %d, PSNR %.1f dB\n", name.c_str(), pass ? "pass" : "FAIL",
+           result.differing, percent, result.maxDelta, result.psnr);
+
+    if (settings.diffDir && result.differing > 0) {
+        std::string diffPath = std::string(settings.diffDir) + "/" + name + "-diff.ppm";
+        WriteDiffImage(diffPath.c_str(), reference, candidate, settings.tolerance);
+    }
+    return pass;
+}
+
+bool IsDirectory(const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) return false;
+    closedir(dir);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    // ImageDiff <reference> <candidate> [--tolerance <0-255>] [--max-percent <p>] [--diff-dir <dir>]
+    // Both paths are PPM files, or directories in which every reference .ppm is compared with the candidate of the same name
+    DiffSettings settings;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) settings.tolerance = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-percent") == 0 && i + 1 < argc) settings.maxPercent = atof(argv[++i]);
+        else if (strcmp(argv[i], "--diff-dir") == 0 && i + 1 < argc) settings.diffDir = argv[++i];
+        else paths.push_back(argv[i]);
+    }
+    if (paths.size() != 2) {
+        printf("Usage: %s <reference> <candidate> [--tolerance n] [--max-percent p] [--diff-dir dir]\n", argv[0]);
+        return 2;
+    }
+
+    if (!IsDirectory(paths[0])) return CompareFiles(paths[0], paths[1], "image", settings) ? 0 : 1;
+
+    std::vector<std::string> names;
+    DIR* dir = opendir(paths[0]);
+    while (dirent* entry = readdir(dir)) {
+        std::string file = entry->d_name;
+        if (file.size() > 4 && file.compare(file.size() - 4, 4, ".ppm") == 0) names.push_back(file.substr(0, file.size() - 4));
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    if (names.empty()) {
+        printf("No reference images in %s\n", paths[0]);
+        return 2;
+    }
+
+    int failures = 0;
+    for (const std::string& name : names) {
+        std::string reference = std::string(paths[0]) + "/" + name + ".ppm";
+        std::string candidate = std::string(paths[1]) + "/" + name + ".ppm";
+        if (!CompareFiles(reference, candidate, name, settings)) failures++;
+    }
+    printf("%zu images, %d failed (tolerance %d, up to %.3f%% of pixels)\n", names.size(), failures, settings.tolerance, settings.maxPercent);
+    return failures == 0 ? 0 : 1;
+}